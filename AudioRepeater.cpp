@@ -1,6 +1,7 @@
 #include "AudioRepeater.h"
 #include "AudioIO.h"
 #include "BufferQueue.h"
+#include <cstring>
 
 namespace LiveKit
 {
@@ -1,6 +1,10 @@
 #include "Camera.h"
 #include "Image.h"
+#include "ImageConverter.h"
+#include "Decoder.h"
+#include "TargetConverter.h"
 #include "VideoPort.h"
+#include "FramePacer.h"
 #include "Utils.h"
 
 
@@ -10,7 +14,6 @@ extern "C" {
 #include <libavformat/avformat.h>
 #include <libavutil/imgutils.h>
 #include <libavutil/log.h>
-#include <libswscale/swscale.h>
 #include <libswresample/swresample.h>
 }
 
@@ -67,7 +70,7 @@ namespace LiveKit
 	}
 
 
-	Camera::Camera(int idx)
+	Camera::Camera(int idx, const DecoderOptions& decoder_options)
 	{
 		static bool s_first_time = true;
 		if (s_first_time)
@@ -82,7 +85,7 @@ namespace LiveKit
 		AVInputFormat *inFrmt = av_find_input_format("dshow");
 		m_p_fmt_ctx = nullptr;
 		avformat_open_input(&m_p_fmt_ctx, url.c_str(), inFrmt, nullptr);
-		avformat_find_stream_info(m_p_fmt_ctx, nullptr);
+		find_stream_info(m_p_fmt_ctx, decoder_options);
 
 		m_v_idx = -1;
 		for (unsigned i = 0; i < m_p_fmt_ctx->nb_streams; i++)
@@ -96,23 +99,17 @@ namespace LiveKit
 			}
 		}
 
-		AVCodecParameters* p_codec_par = m_p_fmt_ctx->streams[m_v_idx]->codecpar;
-		AVCodec* p_codec = avcodec_find_decoder(p_codec_par->codec_id);
-		m_p_codec_ctx = avcodec_alloc_context3(p_codec);
-		avcodec_parameters_to_context(m_p_codec_ctx, p_codec_par);
-		avcodec_open2(m_p_codec_ctx, p_codec, nullptr);
+		m_p_codec_ctx = open_decoder(m_p_fmt_ctx->streams[m_v_idx]->codecpar, decoder_options);
 
 		m_width = m_p_codec_ctx->width;
 		m_height = m_p_codec_ctx->height;
-		m_img = (std::unique_ptr<Image>)(new Image(m_width, m_height));	
+		m_format = ImageConverter::s_native_format(m_p_codec_ctx->pix_fmt);
+		m_outputs = (std::unique_ptr<TargetConverter>)(new TargetConverter(m_format));
 
 		m_p_frm_raw = av_frame_alloc();
-		m_p_frm_bgr = av_frame_alloc();
-
-		av_image_fill_arrays(m_p_frm_bgr->data, m_p_frm_bgr->linesize, m_img->data(), AV_PIX_FMT_BGR24, m_width, m_height, 1);
-		m_sws_ctx = sws_getContext(m_width, m_height, m_p_codec_ctx->pix_fmt, m_width, m_height, AV_PIX_FMT_BGR24, SWS_BICUBIC, nullptr, nullptr, nullptr);
 
 		m_p_packet = std::unique_ptr<AVPacket>(new AVPacket);
+		m_pacer = (std::unique_ptr<FramePacer>)(new FramePacer);
 		m_start_time = time_micro_sec();
 		m_thread_read = (std::unique_ptr<std::thread>)(new std::thread(thread_read, this));		
 	}
@@ -123,13 +120,15 @@ namespace LiveKit
 		m_quit = true;
 		m_thread_read->join();
 
-		sws_freeContext(m_sws_ctx);
-		av_frame_free(&m_p_frm_bgr);
 		av_frame_free(&m_p_frm_raw);
 		avcodec_free_context(&m_p_codec_ctx);
 		avformat_close_input(&m_p_fmt_ctx);
 	}
 
+	void Camera::get_pacing_stats(PacingStats* stats) const
+	{
+		*stats = m_pacer->get_stats();
+	}
 
 	void Camera::thread_read(Camera* self)
 	{
@@ -137,10 +136,7 @@ namespace LiveKit
 		{
 			self->m_frame_count++;
 			uint64_t target = self->m_start_time + self->m_frame_count * self->m_frame_rate_den * AV_TIME_BASE / self->m_frame_rate_num;
-			uint64_t now = time_micro_sec();
-			int64_t delta = target - now;
-			if (delta > 0)
-				std::this_thread::sleep_for(std::chrono::microseconds(delta));
+			self->m_pacer->wait_until(target);
 
 			while (true)
 			{
@@ -155,12 +151,8 @@ namespace LiveKit
 			avcodec_receive_frame(self->m_p_codec_ctx, self->m_p_frm_raw);
 			av_packet_unref(self->m_p_packet.get());
 
-			sws_scale(self->m_sws_ctx, (const uint8_t *const *)self->m_p_frm_raw->data, self->m_p_frm_raw->linesize, 0, self->m_p_codec_ctx->height, self->m_p_frm_bgr->data, self->m_p_frm_bgr->linesize);
-
-			for (size_t i = 0; i < self->m_targets.size(); i++)
-			{
-				self->m_targets[i]->write_image(self->m_img.get());
-			}
+			self->m_outputs->convert(self->m_p_frm_raw, self->m_targets, self->m_images);
+			TargetConverter::s_present(self->m_targets, self->m_images);
 		}
 	}
 
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "DecoderOptions.h"
+
 #include <cstdint>
 #include <string>
 #include <vector>
@@ -13,19 +15,22 @@ namespace std
 struct AVFormatContext;
 struct AVCodecContext;
 struct AVFrame;
-struct SwsContext;
 struct AVPacket;
 
 namespace LiveKit
 {
+	enum class PixelFormat;
 	class Image;
+	class TargetConverter;
 	class VideoTarget;
+	class FramePacer;
+	struct PacingStats;
 	class Camera
 	{
 	public:
 		static const std::vector<std::string>* s_get_list_devices();
 
-		Camera(int idx = 0);
+		Camera(int idx = 0, const DecoderOptions& decoder_options = DecoderOptions());
 		~Camera();
 
 		int idx() const { return m_idx; }
@@ -37,15 +42,17 @@ namespace LiveKit
 			m_targets.push_back(target);
 		}
 
+		void get_pacing_stats(PacingStats* stats) const;
+
 	private:
 		int m_idx;
 		int m_width, m_height;
-		std::unique_ptr<Image> m_img;
 
 		bool m_quit = false;
 		int m_frame_rate_num, m_frame_rate_den;
 		uint64_t m_start_time;
 		size_t m_frame_count = 0;
+		std::unique_ptr<FramePacer> m_pacer;
 
 		static void thread_read(Camera* self);
 		std::unique_ptr<std::thread> m_thread_read;
@@ -54,8 +61,9 @@ namespace LiveKit
 		AVFormatContext* m_p_fmt_ctx;
 		AVCodecContext* m_p_codec_ctx;
 		AVFrame* m_p_frm_raw;
-		AVFrame* m_p_frm_bgr;
-		SwsContext* m_sws_ctx;
+		PixelFormat m_format;
+		std::unique_ptr<TargetConverter> m_outputs;
+		std::vector<std::shared_ptr<const Image>> m_images;
 		std::unique_ptr<AVPacket> m_p_packet;
 
 		std::vector<VideoTarget*> m_targets;
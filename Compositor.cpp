@@ -2,6 +2,8 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 #include "Image.h"
+#include "ImageRecycler.h"
+#include "ImageConverter.h"
 #include "VideoPort.h"
 #include "RenderingOGL.h"
 
@@ -16,6 +18,8 @@ namespace LiveKit
 		}
 		~Layer()
 		{
+			if (source != nullptr && requested)
+				source->cancel_format_request(this);
 			glDeleteTextures(1, &tex);
 		}
 
@@ -27,6 +31,9 @@ namespace LiveKit
 		int height = -1;
 		bool alpha_blend = false;
 		bool flipped = false;
+		ImageConverter converter;
+		VideoFormatRequest request;
+		bool requested = false;
 
 		enum class Mode
 		{
@@ -64,15 +71,40 @@ namespace LiveKit
 			this->pos_y2 = pos_y2;
 		}
 
+		// the source only needs to deliver what the layer covers, in a format that can be uploaded as-is
+		void Request(int video_width, int video_height)
+		{
+			VideoFormatRequest wanted;
+			wanted.packed = true;
+			if (mode == Mode::Stretch)
+			{
+				wanted.width = video_width;
+				wanted.height = video_height;
+			}
+			else if (mode == Mode::StretchMove)
+			{
+				wanted.width = pos_x2 - pos_x;
+				wanted.height = pos_y2 - pos_y;
+			}
+			if (!requested || !(wanted == request))
+			{
+				source->request_format(wanted, this);
+				request = wanted;
+				requested = true;
+			}
+		}
+
 		void Draw(int video_width, int video_height)
 		{
 			if (source != nullptr)
 			{
+				Request(video_width, video_height);
 				uint64_t new_timestamp;
-				const Image* image = source->read_image(&new_timestamp);
+				const Image* image = source->lock_image(&new_timestamp);
 				if (new_timestamp != (uint64_t)(-1) && new_timestamp != timestamp)
 				{
 					timestamp = new_timestamp;
+					const Image* packed = converter.to_packed(image);
 					width = image->width();
 					height = image->height();
 					alpha_blend = image->has_alpha();
@@ -80,21 +112,28 @@ namespace LiveKit
 
 					glBindTexture(GL_TEXTURE_2D, tex);
 					glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+					glPixelStorei(GL_UNPACK_ROW_LENGTH, packed->stride() / packed->pixel_size());
 					glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 					glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 					glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 					glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 					if (image->has_alpha())
 					{
-						glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB_ALPHA, width, height, 0, GL_BGRA, GL_UNSIGNED_BYTE, image->data());
+						glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB_ALPHA, width, height, 0, GL_BGRA, GL_UNSIGNED_BYTE, packed->data());
+					}
+					else if (packed->pixel_size() == 4)
+					{
+						glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB, width, height, 0, GL_BGRA, GL_UNSIGNED_BYTE, packed->data());
 					}
 					else
 					{
-						glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB, width, height, 0, GL_BGR, GL_UNSIGNED_BYTE, image->data());
+						glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB, width, height, 0, GL_BGR, GL_UNSIGNED_BYTE, packed->data());
 					}
+					glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
 					glBindTexture(GL_TEXTURE_2D, 0);
 
 				}
+				source->unlock_image(image);
 			}
 
 			if (alpha_blend)
@@ -127,7 +166,7 @@ namespace LiveKit
 
 
 	Compositor::Compositor(int video_width, int video_height, int window_width, int window_height, const char* title)
-		: m_width_video(video_width), m_height_video(video_height)
+		: m_width_video(video_width), m_height_video(video_height), m_imgs(new ImageRecycler)
 	{
 		glfwInit();
 		m_window = glfwCreateWindow(window_width, window_height, title, NULL, NULL);
@@ -223,16 +262,16 @@ namespace LiveKit
 
 		if (m_targets.size() > 0)
 		{
-			if (m_img == nullptr || m_img->width() != m_width_video || m_img->height() != m_height_video)
-			{
-				m_img = (std::unique_ptr<Image>)(new Image(m_width_video, m_height_video, false));
-				m_img->set_flipped(true);
-			}
-			glReadPixels(0, 0, m_width_video, m_height_video, GL_BGR, GL_UNSIGNED_BYTE, m_img->data());
+			std::shared_ptr<Image> img = m_imgs->get(m_width_video, m_height_video, PixelFormat::BGRX);
+			img->set_flipped(true);
+			glPixelStorei(GL_PACK_ROW_LENGTH, img->stride() / img->pixel_size());
+			glReadPixels(0, 0, m_width_video, m_height_video, GL_BGRA, GL_UNSIGNED_BYTE, img->data());
+			glPixelStorei(GL_PACK_ROW_LENGTH, 0);
 
+			ImageRef frame = img;
 			for (size_t i = 0; i < m_targets.size(); i++)
 			{
-				m_targets[i]->write_image(m_img.get());
+				m_targets[i]->write_image(frame);
 			}
 		}
 
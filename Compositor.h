@@ -8,6 +8,7 @@ struct GLFWwindow;
 namespace LiveKit
 {
 	class Image;
+	class ImageRecycler;
 	class VideoSource;
 	class VideoTarget;
 	class Compositor
@@ -52,7 +53,7 @@ namespace LiveKit
 
 		std::vector<std::unique_ptr<Layer>> m_layers;
 
-		std::unique_ptr<Image> m_img;
+		std::unique_ptr<ImageRecycler> m_imgs;
 		std::vector<VideoTarget*> m_targets;
 
 	};
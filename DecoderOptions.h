@@ -0,0 +1,41 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace LiveKit
+{
+	enum class DecoderThreading
+	{
+		Default, // frame and slice threading, as far as the codec supports them
+		Frame, // more throughput, but a frame of delay per thread
+		Slice, // no delay, parallel only within a frame and only for streams coded in several slices
+	};
+
+	// what the decoder may leave out, in increasing order, like FFmpeg's AVDiscard
+	enum class DecoderSkip
+	{
+		Default, // nothing but what is invalid anyway
+		NonRef, // non-reference frames
+		Bidir, // bidirectionally predicted frames
+		NonIntra, // all but intra frames
+		NonKey, // all but keyframes
+		All
+	};
+
+	// How a source opens its decoders. Applies to the decoders FFmpeg opens to probe an input as well,
+	// except for the skip options.
+	struct DecoderOptions
+	{
+		int thread_count = 1; // 0 picks one per core
+		DecoderThreading thread_type = DecoderThreading::Default;
+		bool low_delay = false; // output frames as soon as they are decoded
+		DecoderSkip skip_frame = DecoderSkip::Default;
+		DecoderSkip skip_loop_filter = DecoderSkip::Default;
+		DecoderSkip skip_idct = DecoderSkip::Default;
+
+		// further options of the codec context, passed to avcodec_open2() by name
+		std::vector<std::pair<std::string, std::string>> extra;
+	};
+}
@@ -1,5 +1,6 @@
 #include "IPCSource.h"
 #include "Image.h"
+#include "ImageCopy.h"
 #include "Utils.h"
 
 namespace LiveKit
@@ -18,56 +19,101 @@ namespace LiveKit
 		uint64_t timestamp;
 	};
 
+	// another IPCSource on the same mapping can take a wake-up of the auto-reset event, so waits
+	// also end after this long to look at the timestamp
+	static const DWORD s_max_wait_ms = 10;
+
 	IPCSource::IPCSource(const char* mapping_name)
 	{
 		m_mapping_name = mapping_name;
+		// created here as well, so that the source can wait before the target exists
+		m_hFrameEvent = CreateEventA(NULL, FALSE, FALSE, (m_mapping_name + "_frame").c_str());
 	}
 
 	IPCSource::~IPCSource()
 	{
+		if (m_view != nullptr)
+		{
+			UnmapViewOfFile(m_view);
+		}
 		if (m_hMapFile != nullptr)
 		{
 			CloseHandle(m_hMapFile);
 		}
+		if (m_hFrameEvent != nullptr)
+		{
+			CloseHandle(m_hFrameEvent);
+		}
 	}
 
-	const Image* IPCSource::read_image(uint64_t* timestamp) const
+	const unsigned char* IPCSource::_map() const
 	{
-		*timestamp = m_timestamp;
-
-		void *data = nullptr;
-		if (m_hMapFile == nullptr)
+		if (m_view == nullptr)
 		{
-			m_hMapFile = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, m_mapping_name.c_str());
-			if (m_hMapFile == nullptr) return m_frame.get();
-			data = MapViewOfFile(m_hMapFile, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(Header));
-			if (data == nullptr) return m_frame.get();
+			if (m_hMapFile == nullptr)
+			{
+				m_hMapFile = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, m_mapping_name.c_str());
+				if (m_hMapFile == nullptr) return nullptr;
+			}
+			// the whole mapping stays in view until the source is destroyed
+			m_view = MapViewOfFile(m_hMapFile, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+			if (m_view == nullptr)
+			{
+				CloseHandle(m_hMapFile);
+				m_hMapFile = nullptr;
+			}
 		}
-		else
+		return (const unsigned char*)m_view;
+	}
+
+	uint64_t IPCSource::peek_timestamp() const
+	{
+		const unsigned char* data = _map();
+		if (data == nullptr) return m_timestamp;
+
+		// only the frame header is read, the pixels stay untouched
+		const Header* header = (const Header*)data;
+		size_t frame_size = sizeof(FrameHeader) + header->width * header->height * header->chn;
+		size_t frame_offset = sizeof(Header) + frame_size * header->cur_frame;
+		return ((const FrameHeader*)(data + frame_offset))->timestamp;
+	}
+
+	bool IPCSource::wait_image(uint64_t last_timestamp, int timeout_ms) const
+	{
+		// IPCTarget signals the event after each frame it writes
+		uint64_t deadline = time_micro_sec() + (uint64_t)timeout_ms * 1000;
+		while (true)
 		{
-			data = MapViewOfFile(m_hMapFile, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(Header));
-			if (data == nullptr)
+			uint64_t timestamp = peek_timestamp();
+			if (timestamp != (uint64_t)(-1) && timestamp != last_timestamp) return true;
+			DWORD wait_ms = s_max_wait_ms;
+			if (timeout_ms >= 0)
 			{
-				CloseHandle(m_hMapFile);
-				m_hMapFile = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, m_mapping_name.c_str());
-				if (m_hMapFile == nullptr) return m_frame.get();
-				data = MapViewOfFile(m_hMapFile, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(Header));
-				if (data == nullptr) return m_frame.get();
+				uint64_t now = time_micro_sec();
+				if (now >= deadline) return false;
+				uint64_t left_ms = (deadline - now + 999) / 1000;
+				if (left_ms < wait_ms) wait_ms = (DWORD)left_ms;
 			}
+			WaitForSingleObject(m_hFrameEvent, wait_ms);
 		}
+	}
 
-		Header* header = (Header*)data;
+	const Image* IPCSource::read_image(uint64_t* timestamp) const
+	{
+		*timestamp = m_timestamp;
+
+		const unsigned char* data = _map();
+		if (data == nullptr) return m_frame.get();
+
+		const Header* header = (const Header*)data;
 		int width = header->width;
 		int height = header->height;
 		int chn = header->chn;
 		int cur_frame = header->cur_frame;
 		size_t frame_size = sizeof(FrameHeader) + width * height*chn;
-		size_t total_size = sizeof(Header) + frame_size * 3;
 
-		UnmapViewOfFile(data);
-		data = MapViewOfFile(m_hMapFile, FILE_MAP_ALL_ACCESS, 0, 0, total_size);
-		unsigned char* p_frames = (unsigned char*)data + sizeof(Header);
-		FrameHeader* frame_header = (FrameHeader*)(p_frames + frame_size * cur_frame);
+		const unsigned char* p_frames = data + sizeof(Header);
+		const FrameHeader* frame_header = (const FrameHeader*)(p_frames + frame_size * cur_frame);
 		uint64_t ts = frame_header->timestamp;
 		if (ts != m_timestamp)
 		{			
@@ -76,13 +122,11 @@ namespace LiveKit
 			bool is_flipped = frame_header->is_flipped!=0;
 			m_frame->set_flipped(is_flipped);
 			const unsigned char* p_data = (const unsigned char*)(frame_header + 1);
-			memcpy(m_frame->data(), p_data, width * height*chn);
+			copy_centered(p_data, width, height, chn, width * chn, m_frame->data(), width, height, chn, m_frame->stride(), false);
 			m_timestamp = ts;
 			*timestamp = m_timestamp;
 		}
 
-		UnmapViewOfFile(data);
-
 		return m_frame.get();
 	}
 
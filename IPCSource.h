@@ -13,15 +13,20 @@ namespace LiveKit
 		~IPCSource();
 
 		virtual const Image* read_image(uint64_t* timestamp) const;
+		virtual uint64_t peek_timestamp() const;
+		virtual bool wait_image(uint64_t last_timestamp, int timeout_ms = -1) const;
 
 	private:
 		std::string m_mapping_name;
 		mutable HANDLE m_hMapFile = nullptr;
+		mutable void* m_view = nullptr;
+		HANDLE m_hFrameEvent = nullptr;
 		mutable std::unique_ptr<Image> m_frame;
 		mutable uint64_t m_timestamp = (uint64_t)(-1);
 		struct Header;
 		struct FrameHeader;
-		
+
+		const unsigned char* _map() const;
 
 	};
 
@@ -1,6 +1,9 @@
 #include "IPCTarget.h"
 #include "Image.h"
+#include "ImageConverter.h"
+#include "ImageCopy.h"
 #include "Utils.h"
+#include <string>
 
 namespace LiveKit
 {
@@ -19,6 +22,7 @@ namespace LiveKit
 	};
 
 	IPCTarget::IPCTarget(const char* mapping_name, int width, int height, bool has_alpha)
+		: m_converter(new ImageConverter)
 	{
 		int chn = has_alpha ? 4 : 3;
 		size_t total_size = sizeof(Header) + (sizeof(FrameHeader) + width*height*chn) * 3;
@@ -26,12 +30,22 @@ namespace LiveKit
 		m_data = MapViewOfFile(m_hMapFile, FILE_MAP_ALL_ACCESS, 0, 0, total_size);
 		memset(m_data, 0, total_size);
 		*(Header*)m_data = { width, height, chn, 2 };
+		// set after every frame, IPCSource::wait_image() waits on it
+		m_hFrameEvent = CreateEventA(NULL, FALSE, FALSE, (std::string(mapping_name) + "_frame").c_str());
 	}
 
 	IPCTarget::~IPCTarget()
 	{
 		UnmapViewOfFile(m_data);
 		CloseHandle(m_hMapFile);
+		CloseHandle(m_hFrameEvent);
+	}
+
+	bool IPCTarget::get_format_request(VideoFormatRequest* request) const
+	{
+		*request = VideoFormatRequest();
+		request->packed = true;
+		return true;
 	}
 
 	void IPCTarget::write_image(const Image* image)
@@ -47,14 +61,16 @@ namespace LiveKit
 		int write_frame = (cur_frame + 1) % 3;
 
 		FrameHeader* frame_header = (FrameHeader*)(p_frames + frame_size * write_frame);
+		image = m_converter->to_packed(image);
 		frame_header->is_flipped = image->is_flipped()?1:0;
 		frame_header->timestamp = time_micro_sec();
 
 		unsigned char* p_data_out = (unsigned char*)(frame_header + 1);
-		copy_centered(image->data(), image->width(), image->height(), image->has_alpha() ? 4 : 3,
-			p_data_out, width_out, height_out, chn_out, false);
+		copy_centered(image->data(), image->width(), image->height(), image->pixel_size(), image->stride(),
+			p_data_out, width_out, height_out, chn_out, width_out * chn_out, false);
 
 		header->cur_frame = write_frame;
+		SetEvent(m_hFrameEvent);
 
 	}
 
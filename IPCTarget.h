@@ -2,9 +2,11 @@
 
 #include "VideoPort.h"
 #include <Windows.h>
+#include <memory>
 
 namespace LiveKit
 {
+	class ImageConverter;
 	class IPCTarget : public VideoTarget
 	{
 	public:
@@ -13,11 +15,16 @@ namespace LiveKit
 
 		virtual void write_image(const Image* image);
 
+		// frames are copied packed and unscaled, centered on the shared buffer
+		virtual bool get_format_request(VideoFormatRequest* request) const;
+
 	private:
 		HANDLE m_hMapFile = nullptr;
 		void* m_data = nullptr;
+		HANDLE m_hFrameEvent = nullptr;
 		struct Header;
 		struct FrameHeader;
+		std::unique_ptr<ImageConverter> m_converter;
 
 	};
 
@@ -4,8 +4,8 @@
 
 namespace LiveKit
 {
-	ImageFile::ImageFile(const char* filename)
-		:m_image(new Image(filename, true))
+	ImageFile::ImageFile(const char* filename, const DecoderOptions& decoder_options)
+		:m_image(new Image(filename, true, decoder_options))
 	{
 		m_timestamp = time_micro_sec();
 		
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "VideoPort.h"
+#include "DecoderOptions.h"
 #include <memory>
 
 namespace LiveKit
@@ -10,7 +11,7 @@ namespace LiveKit
 	class ImageFile : public VideoSource
 	{
 	public:
-		ImageFile(const char* filename);
+		ImageFile(const char* filename, const DecoderOptions& decoder_options = DecoderOptions());
 		~ImageFile();
 
 		int width() const;
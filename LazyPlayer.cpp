@@ -1,5 +1,9 @@
 #include "LazyPlayer.h"
 #include "Image.h"
+#include "ImageConverter.h"
+#include "Decoder.h"
+#include "KeyframeIndex.h"
+#include "TargetConverter.h"
 #include "Utils.h"
 
 extern "C" {
@@ -7,7 +11,6 @@ extern "C" {
 #include <libavformat/avformat.h>
 #include <libavutil/imgutils.h>
 #include <libavutil/log.h>
-#include <libswscale/swscale.h>
 #include <libswresample/swresample.h>
 }
 
@@ -16,13 +19,13 @@ namespace LiveKit
 	class LazyPlayer::Internal
 	{
 	public:
-		Internal(const char* fn)
+		Internal(const char* fn, const DecoderOptions& decoder_options)
 		{
 			if (!exists_test(fn))
 				printf("Failed loading %s\n", fn);
 
 			avformat_open_input(&m_p_fmt_ctx, fn, nullptr, nullptr);
-			avformat_find_stream_info(m_p_fmt_ctx, nullptr);
+			find_stream_info(m_p_fmt_ctx, decoder_options);
 			m_duration = m_p_fmt_ctx->duration;
 
 			for (unsigned i = 0; i < m_p_fmt_ctx->nb_streams; i++)
@@ -40,30 +43,22 @@ namespace LiveKit
 				printf("%s is not a video file.\n", fn);
 			}
 
-			AVCodecParameters* p_codec_par = m_p_fmt_ctx->streams[m_v_idx]->codecpar;
-			AVCodec* p_codec = avcodec_find_decoder(p_codec_par->codec_id);
-			m_p_codec_ctx_video = avcodec_alloc_context3(p_codec);
-			avcodec_parameters_to_context(m_p_codec_ctx_video, p_codec_par);
-			avcodec_open2(m_p_codec_ctx_video, p_codec, nullptr);
+			m_p_codec_ctx_video = open_decoder(m_p_fmt_ctx->streams[m_v_idx]->codecpar, decoder_options);
 
 			m_p_frm_raw_video = av_frame_alloc();
-			m_p_frm_bgr_video = av_frame_alloc();
 
 			m_video_width = m_p_codec_ctx_video->width;
 			m_video_height = m_p_codec_ctx_video->height;
-			m_video_buffer = (std::unique_ptr<Image>)(new Image(m_video_width, m_video_height));
-
-			av_image_fill_arrays(m_p_frm_bgr_video->data, m_p_frm_bgr_video->linesize, m_video_buffer->data(), AV_PIX_FMT_BGR24, m_video_width, m_video_height, 1);
-			m_sws_ctx = sws_getContext(m_video_width, m_video_height, m_p_codec_ctx_video->pix_fmt, m_video_width, m_video_height, AV_PIX_FMT_BGR24, SWS_BICUBIC, nullptr, nullptr, nullptr);
+			m_video_format = ImageConverter::s_native_format(m_p_codec_ctx_video->pix_fmt);
+			m_video_buffer = (std::unique_ptr<Image>)(new Image(m_video_width, m_video_height, m_video_format));
 
 			m_p_packet = std::unique_ptr<AVPacket>(new AVPacket);
+			m_index = (std::unique_ptr<KeyframeIndex>)(new KeyframeIndex(fn, m_v_idx));
 
 			m_position = 0;
 		}
 		~Internal()
 		{
-			sws_freeContext(m_sws_ctx);
-			av_frame_free(&m_p_frm_bgr_video);
 			av_frame_free(&m_p_frm_raw_video);
 			avcodec_free_context(&m_p_codec_ctx_video);
 			avformat_close_input(&m_p_fmt_ctx);
@@ -76,35 +71,32 @@ namespace LiveKit
 		void set_position(uint64_t pos)
 		{
 			m_position = pos;
-			avformat_seek_file(m_p_fmt_ctx, -1, INT64_MIN, pos, INT64_MAX, 0);
+			m_index->seek(m_p_fmt_ctx, m_p_codec_ctx_video, _pts(pos));
 		}
 
-		bool fetch()
+		// decodes up to the first frame shown at or after 'pos', only that frame is converted
+		bool fetch(uint64_t pos)
 		{
-			bool frame_read = false;
-			while (av_read_frame(m_p_fmt_ctx, m_p_packet.get()) == 0)
-			{
-				if (m_p_packet->stream_index == m_v_idx)
-				{
-					int64_t t = m_p_packet->dts * m_video_time_base_num * AV_TIME_BASE / m_video_time_base_den;
-					avcodec_send_packet(m_p_codec_ctx_video, m_p_packet.get());
-					avcodec_receive_frame(m_p_codec_ctx_video, m_p_frm_raw_video);
-					av_packet_unref(m_p_packet.get());
-					if (t >= (int64_t)m_position)
-					{
-						m_position = (uint64_t)t;
-						sws_scale(m_sws_ctx, (const uint8_t *const *)m_p_frm_raw_video->data, m_p_frm_raw_video->linesize,
-							0, m_p_codec_ctx_video->height, m_p_frm_bgr_video->data, m_p_frm_bgr_video->linesize);
-						frame_read = true;
-						break;
-					}
-				}
-				else
-				{
-					av_packet_unref(m_p_packet.get());
-				}
-			}
-			return frame_read;
+			if (!decode_to_frame(m_p_fmt_ctx, m_p_codec_ctx_video, m_v_idx, _pts(pos), m_p_packet.get(), m_p_frm_raw_video))
+				return false;
+
+			int64_t t = m_p_frm_raw_video->best_effort_timestamp;
+			if (t != AV_NOPTS_VALUE)
+				m_position = (uint64_t)(t * m_video_time_base_num * AV_TIME_BASE / m_video_time_base_den);
+			else
+				m_position = pos;
+
+			int width = m_p_frm_raw_video->width;
+			int height = m_p_frm_raw_video->height;
+			PixelFormat format = m_video_format;
+			VideoFormatRequest request;
+			if (m_requests.get(&request))
+				TargetConverter::s_resolve(request, width, height, format);
+			if (m_video_buffer->width() != width || m_video_buffer->height() != height || m_video_buffer->format() != format)
+				m_video_buffer = (std::unique_ptr<Image>)(new Image(width, height, format));
+			m_converter.frame_to_image(m_p_frm_raw_video, m_video_buffer.get());
+			av_frame_unref(m_p_frm_raw_video);
+			return true;
 		}
 
 		const Image* get_image() const
@@ -112,6 +104,17 @@ namespace LiveKit
 			return m_video_buffer.get();
 		}
 
+		// applies from the next frame fetched
+		void set_request(const void* reader, const VideoFormatRequest& request)
+		{
+			m_requests.set(reader, request);
+		}
+
+		void cancel_request(const void* reader)
+		{
+			m_requests.remove(reader);
+		}
+
 	private:
 
 		AVFormatContext* m_p_fmt_ctx = nullptr;
@@ -123,15 +126,22 @@ namespace LiveKit
 
 		AVCodecContext* m_p_codec_ctx_video;
 		AVFrame *m_p_frm_raw_video;
-		AVFrame *m_p_frm_bgr_video;
+		PixelFormat m_video_format;
 		std::unique_ptr<Image> m_video_buffer;
-		SwsContext* m_sws_ctx;
+		ImageConverter m_converter;
+		VideoFormatRequests m_requests;
 
 		std::unique_ptr<AVPacket> m_p_packet;
+		std::unique_ptr<KeyframeIndex> m_index;
+
+		int64_t _pts(uint64_t pos) const
+		{
+			return av_rescale((int64_t)pos, m_video_time_base_den, (int64_t)m_video_time_base_num * AV_TIME_BASE);
+		}
 
 	};
 
-	LazyPlayer::LazyPlayer(const char* fn) : m_internal(new Internal(fn))
+	LazyPlayer::LazyPlayer(const char* fn, const DecoderOptions& decoder_options) : m_internal(new Internal(fn, decoder_options))
 	{
 		
 	}
@@ -199,12 +209,22 @@ namespace LiveKit
 		m_start_pos = pos;
 		m_start_time = time_micro_sec();
 		m_internal->set_position(pos);
-		if (m_internal->fetch())
+		if (m_internal->fetch(pos))
 		{
 			m_timestamp = time_micro_sec();
 		}
 	}
 
+	void LazyPlayer::request_format(const VideoFormatRequest& request, const void* reader) const
+	{
+		m_internal->set_request(reader, request);
+	}
+
+	void LazyPlayer::cancel_format_request(const void* reader) const
+	{
+		m_internal->cancel_request(reader);
+	}
+
 	const Image* LazyPlayer::read_image(uint64_t* timestamp) const
 	{
 		uint64_t duration = m_internal->get_duration();
@@ -215,10 +235,10 @@ namespace LiveKit
 			return m_internal->get_image();
 		}
 
-		while (m_internal->get_position() < cur_pos)
+		if (m_internal->get_position() < cur_pos)
 		{
-			if (!m_internal->fetch()) break;
-			m_timestamp = time_micro_sec();
+			if (m_internal->fetch(cur_pos))
+				m_timestamp = time_micro_sec();
 		}
 		*timestamp = m_timestamp;
 		return m_internal->get_image();
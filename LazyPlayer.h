@@ -1,6 +1,7 @@
 #pragma once
 
 #include "VideoPort.h"
+#include "DecoderOptions.h"
 #include <memory>
 
 namespace LiveKit
@@ -10,7 +11,7 @@ namespace LiveKit
 	class LazyPlayer : public VideoSource
 	{
 	public:
-		LazyPlayer(const char* fn);
+		LazyPlayer(const char* fn, const DecoderOptions& decoder_options = DecoderOptions());
 		~LazyPlayer();
 
 		int video_width() const;
@@ -26,6 +27,8 @@ namespace LiveKit
 		void set_position(uint64_t pos);
 		
 		virtual const Image* read_image(uint64_t* timestamp) const;
+		virtual void request_format(const VideoFormatRequest& request, const void* reader) const;
+		virtual void cancel_format_request(const void* reader) const;
 
 	private:
 		class Internal;		
@@ -1,8 +1,17 @@
 #include "Player.h"
 #include "AudioBuffer.h"
 #include "Image.h"
+#include "ImageConverter.h"
+#include "TargetConverter.h"
 #include "VideoPort.h"
 #include "AudioIO.h"
+#include "Decoder.h"
+#include "FramePacer.h"
+#include "KeyframeIndex.h"
+#include "PacketQueue.h"
+#include "PcmRing.h"
+#include "PauseGate.h"
+#include "StageQueue.h"
 #include "Utils.h"
 
 extern "C" {
@@ -10,20 +19,67 @@ extern "C" {
 #include <libavformat/avformat.h>
 #include <libavutil/imgutils.h>
 #include <libavutil/log.h>
-#include <libswscale/swscale.h>
 #include <libswresample/swresample.h>
+#include <libavfilter/avfilter.h>
+#include <libavfilter/buffersrc.h>
+#include <libavfilter/buffersink.h>
 }
 
-#include <queue>
 #include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <string>
 
 namespace LiveKit
 {
-	void get_media_info(const char* fn, MediaInfo* info)
+	// upper bounds of the demux queues, the read-ahead duration usually fills them much less
+	static const size_t s_audio_queue_bytes = 4 * 1024 * 1024;
+	static const size_t s_video_queue_bytes = 128 * 1024 * 1024;
+
+	// microseconds of decoded audio buffered between the audio decoder and the device
+	static const int s_audio_ring_duration = 500000;
+
+	// stream index of the empty packet that tells a decoder thread to move on to the next decoder
+	static const int s_decoder_switch = -1;
+
+	// probing limits of fast-start mode, instead of FFmpeg's 5MB / 5s
+	static const int64_t s_fast_probesize = 256 * 1024;
+	static const int64_t s_fast_analyze_duration = 500000;
+
+	// live mode: latency allowed above the target before catching up, and the window over which the
+	// least delayed packet marks the live edge, microseconds
+	static const int64_t s_live_tolerance = 250000;
+	static const uint64_t s_live_edge_window = 10000000;
+
+	// lateness of the video packets being decoded, in microseconds, from which the decoder skips
+	// non-reference frames, and from which it also skips deblocking of reference frames
+	static const int64_t s_shed_nonref_lateness = 100000;
+	static const int64_t s_shed_loop_filter_lateness = 500000;
+
+	// level 0 restores what the decoder was opened with
+	static void s_apply_shedding(AVCodecContext* codec_ctx, int level, const DecoderOptions& options)
+	{
+		AVDiscard skip_frame = to_av_discard(options.skip_frame);
+		AVDiscard skip_loop_filter = to_av_discard(options.skip_loop_filter);
+		if (level >= 1)
+		{
+			skip_frame = max(skip_frame, AVDISCARD_NONREF);
+			skip_loop_filter = max(skip_loop_filter, level >= 2 ? AVDISCARD_ALL : AVDISCARD_NONREF);
+		}
+		codec_ctx->skip_frame = skip_frame;
+		codec_ctx->skip_loop_filter = skip_loop_filter;
+	}
+
+	// playback rates accepted by set_rate()
+	static const double s_min_rate = 0.25;
+	static const double s_max_rate = 16.0;
+
+	void get_media_info(const char* fn, MediaInfo* info, const DecoderOptions& decoder_options)
 	{
 		AVFormatContext* p_fmt_ctx = nullptr;
 		avformat_open_input(&p_fmt_ctx, fn, nullptr, nullptr);
-		avformat_find_stream_info(p_fmt_ctx, nullptr);
+		find_stream_info(p_fmt_ctx, decoder_options);
 		info->duration = p_fmt_ctx->duration;
 		for (unsigned i = 0; i < p_fmt_ctx->nb_streams; i++)
 		{
@@ -49,212 +105,716 @@ namespace LiveKit
 	}
 
 
-	class Player::PacketQueue
+	// whether a decoder opened for 'a' can go on with the packets of 'b'
+	static bool s_same_codec(const AVCodecParameters* a, const AVCodecParameters* b)
+	{
+		if (a->codec_type != b->codec_type || a->codec_id != b->codec_id || a->format != b->format) return false;
+		if (a->width != b->width || a->height != b->height) return false;
+		if (a->sample_rate != b->sample_rate || a->channels != b->channels) return false;
+		if (a->extradata_size != b->extradata_size) return false;
+		return a->extradata_size == 0 || memcmp(a->extradata, b->extradata, a->extradata_size) == 0;
+	}
+
+	// Files to play after the current one. The next file is opened on a background thread while the
+	// current one is still playing, so that the demuxer moves on at its end without a gap. Decoders
+	// are only replaced for files whose codec parameters differ; they are opened ahead as well and
+	// handed to the decoder threads in stream order, behind a marker packet.
+	class Player::Playlist
 	{
 	public:
-		PacketQueue(int cache_size)
+		struct Item
+		{
+			std::string fn;
+			AVFormatContext* fmt_ctx = nullptr;
+			int a_idx = -1;
+			int v_idx = -1;
+			AVCodecContext* codec_ctx_audio = nullptr; // only when the running decoder cannot be reused
+			AVCodecContext* codec_ctx_video = nullptr;
+			std::unique_ptr<KeyframeIndex> index;
+
+			~Item()
+			{
+				avcodec_free_context(&codec_ctx_audio);
+				avcodec_free_context(&codec_ctx_video);
+				avformat_close_input(&fmt_ctx);
+			}
+		};
+
+		Playlist(Player* player, const char* fn) : m_current(fn), m_decoder_options(player->m_decoder_options), m_live(player->m_live)
+		{
+			if (player->m_a_idx >= 0)
+			{
+				m_par_audio = avcodec_parameters_alloc();
+				avcodec_parameters_copy(m_par_audio, player->m_p_fmt_ctx->streams[player->m_a_idx]->codecpar);
+			}
+			if (player->m_v_idx >= 0)
+			{
+				m_par_video = avcodec_parameters_alloc();
+				avcodec_parameters_copy(m_par_video, player->m_p_fmt_ctx->streams[player->m_v_idx]->codecpar);
+			}
+		}
+
+		~Playlist()
+		{
+			Clear();
+			if (m_thread_prepare != nullptr)
+				m_thread_prepare->join();
+			for (size_t i = 0; i < m_decoders_audio.size(); i++)
+				avcodec_free_context(&m_decoders_audio[i]);
+			for (size_t i = 0; i < m_decoders_video.size(); i++)
+				avcodec_free_context(&m_decoders_video[i]);
+			avcodec_parameters_free(&m_par_audio);
+			avcodec_parameters_free(&m_par_video);
+		}
+
+		void Append(const char* fn)
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_files.push_back(fn);
+			_prepare_next();
+		}
+
+		void Clear()
 		{
-			InitializeCriticalSectionAndSpinCount(&m_cs, 0x00000400);
-			m_semaphore_in = CreateSemaphore(nullptr, cache_size, (1u << 31) - 1, nullptr);
-			m_semaphore_out = CreateSemaphore(nullptr, 0, (1u << 31) - 1, nullptr);
+			std::unique_ptr<Item> next;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_files.clear();
+				next = std::move(m_next);
+				m_generation++;
+			}
+		}
+
+		size_t Size() const
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			return m_files.size() + (m_next != nullptr || m_preparing ? 1 : 0);
+		}
+
+		// demuxer: the next file, waits for it to be opened. nullptr at the end of the playlist
+		std::unique_ptr<Item> TakeNext(bool loop)
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_prepared.wait(lock, [this]() { return !m_preparing; });
+			std::unique_ptr<Item> item = std::move(m_next);
+			if (item != nullptr)
+			{
+				// later files are compared with this one's decoders
+				if (item->a_idx >= 0 && m_par_audio != nullptr)
+					avcodec_parameters_copy(m_par_audio, item->fmt_ctx->streams[item->a_idx]->codecpar);
+				if (item->v_idx >= 0 && m_par_video != nullptr)
+					avcodec_parameters_copy(m_par_video, item->fmt_ctx->streams[item->v_idx]->codecpar);
+				if (loop) m_files.push_back(m_current);
+				m_current = item->fn;
+				_prepare_next();
+			}
+			return item;
+		}
+
+		void PushDecoder(AVMediaType type, AVCodecContext* codec_ctx)
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			(type == AVMEDIA_TYPE_AUDIO ? m_decoders_audio : m_decoders_video).push_back(codec_ctx);
+		}
+
+		// nullptr if there is none waiting
+		AVCodecContext* PopDecoder(AVMediaType type)
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			std::deque<AVCodecContext*>& decoders = type == AVMEDIA_TYPE_AUDIO ? m_decoders_audio : m_decoders_video;
+			if (decoders.empty()) return nullptr;
+			AVCodecContext* codec_ctx = decoders.front();
+			decoders.pop_front();
+			return codec_ctx;
 		}
 
-		~PacketQueue()
+		// the timeline position where a file starts, and the shift applied to its timestamps.
+		// 'new_file' is false when the same file starts over
+		void AddSegment(uint64_t start, int64_t offset, bool new_file)
 		{
-			CloseHandle(m_semaphore_out);
-			CloseHandle(m_semaphore_in);
-			DeleteCriticalSection(&m_cs);
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_segments.push_back({ start, offset, new_file });
+			if (m_segments.size() > s_max_segments) m_segments.pop_front();
 		}
 
-		size_t Size()
+		// also drops the file kept by SetLeft()
+		void ClearSegments()
 		{
-			return m_queue.size();
+			std::unique_ptr<Item> left;
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_segments.clear();
+			left = std::move(m_left);
 		}
 
-		AVPacket Front()
+		// files the demuxer has moved on to since the one playing at 'progress'
+		int FilesAhead(uint64_t progress) const
 		{
-			return m_queue.front();
+			std::unique_lock<std::mutex> lock(m_mutex);
+			int ahead = 0;
+			for (size_t i = 0; i < m_segments.size(); i++)
+				if (m_segments[i].start > progress && m_segments[i].new_file) ahead++;
+			return ahead;
 		}
 
-		void Push(AVPacket packet)
+		// demuxer: the file it has just left, kept while it may still be playing
+		void SetLeft(std::unique_ptr<Item> item)
 		{
-			WaitForSingleObject(m_semaphore_in, INFINITE);
-			EnterCriticalSection(&m_cs);
-			m_queue.push(packet);
-			LeaveCriticalSection(&m_cs);
-			ReleaseSemaphore(m_semaphore_out, 1, nullptr);
+			std::unique_ptr<Item> previous;
+			std::unique_lock<std::mutex> lock(m_mutex);
+			previous = std::move(m_left);
+			m_left = std::move(item);
 		}
 
-		AVPacket Pop()
+		std::unique_ptr<Item> TakeLeft()
 		{
-			WaitForSingleObject(m_semaphore_out, INFINITE);
-			EnterCriticalSection(&m_cs);
-			AVPacket ret = m_queue.front();
-			m_queue.pop();
-			LeaveCriticalSection(&m_cs);
-			ReleaseSemaphore(m_semaphore_in, 1, nullptr);
-			return ret;
+			std::unique_lock<std::mutex> lock(m_mutex);
+			return std::move(m_left);
+		}
+
+		// the demuxer goes back to 'played', the file it was in ('demuxed') is opened again to follow it.
+		// 'par_audio' and 'par_video' are the streams of 'played', nullptr for those it lacks
+		void Rewind(const std::string& played, const std::string& demuxed, const AVCodecParameters* par_audio, const AVCodecParameters* par_video, bool loop)
+		{
+			std::unique_ptr<Item> next;
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_prepared.wait(lock, [this]() { return !m_preparing; });
+			next = std::move(m_next);
+			if (next != nullptr) m_files.push_front(next->fn);
+
+			// looping queued 'played' again when the demuxer left it
+			if (loop)
+			{
+				for (size_t i = m_files.size(); i-- > 0; )
+				{
+					if (m_files[i] == played)
+					{
+						m_files.erase(m_files.begin() + i);
+						break;
+					}
+				}
+			}
+			m_files.push_front(demuxed);
+			m_current = played;
+			if (par_audio != nullptr && m_par_audio != nullptr)
+				avcodec_parameters_copy(m_par_audio, par_audio);
+			if (par_video != nullptr && m_par_video != nullptr)
+				avcodec_parameters_copy(m_par_video, par_video);
+			m_generation++;
+			_prepare_next();
+		}
+
+		// shift of the file playing at 'progress'. 'last' tells if the demuxer is still in that file
+		int64_t OffsetAt(uint64_t progress, bool* last = nullptr) const
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			int64_t offset = 0;
+			size_t i = 0;
+			for (; i < m_segments.size() && m_segments[i].start <= progress; i++)
+				offset = m_segments[i].offset;
+			if (last != nullptr) *last = i == m_segments.size();
+			return offset;
 		}
 
 	private:
-		std::queue<AVPacket> m_queue;
-		CRITICAL_SECTION m_cs;
-		HANDLE m_semaphore_in;
-		HANDLE m_semaphore_out;
+		struct Segment
+		{
+			uint64_t start;
+			int64_t offset;
+			bool new_file;
+		};
+		static const size_t s_max_segments = 64;
+
+		mutable std::mutex m_mutex;
+		std::condition_variable m_prepared;
+		std::deque<std::string> m_files;
+		std::string m_current;
+		DecoderOptions m_decoder_options;
+		bool m_live; // no keyframe index, see Player::_seek()
+		std::unique_ptr<Item> m_next;
+		bool m_preparing = false;
+		uint64_t m_generation = 0; // bumped by Clear(), so that a file being opened meanwhile is dropped
+		std::unique_ptr<std::thread> m_thread_prepare;
+
+		// the streams the running decoders were opened for, or will be once the demuxer reaches m_next
+		AVCodecParameters* m_par_audio = nullptr;
+		AVCodecParameters* m_par_video = nullptr;
+		std::deque<AVCodecContext*> m_decoders_audio;
+		std::deque<AVCodecContext*> m_decoders_video;
+
+		std::deque<Segment> m_segments;
+		std::unique_ptr<Item> m_left;
+
+		// with m_mutex held
+		void _prepare_next()
+		{
+			if (m_preparing || m_next != nullptr || m_files.empty()) return;
+			if (m_thread_prepare != nullptr)
+				m_thread_prepare->join();
+			m_preparing = true;
+			m_thread_prepare = (std::unique_ptr<std::thread>)(new std::thread(thread_prepare, this));
+		}
+
+		Item* _open(const std::string& fn) const
+		{
+			Item* item = new Item;
+			item->fn = fn;
+			if (avformat_open_input(&item->fmt_ctx, fn.c_str(), nullptr, nullptr) != 0 || find_stream_info(item->fmt_ctx, m_decoder_options) < 0)
+			{
+				printf("Failed loading %s\n", fn.c_str());
+				delete item;
+				return nullptr;
+			}
+
+			// only the kinds of streams the player started with are played
+			for (unsigned i = 0; i < item->fmt_ctx->nb_streams; i++)
+			{
+				AVMediaType type = item->fmt_ctx->streams[i]->codecpar->codec_type;
+				if (m_par_audio != nullptr && type == AVMEDIA_TYPE_AUDIO) item->a_idx = i;
+				if (m_par_video != nullptr && type == AVMEDIA_TYPE_VIDEO) item->v_idx = i;
+			}
+
+			if (item->a_idx >= 0)
+			{
+				const AVCodecParameters* codec_par = item->fmt_ctx->streams[item->a_idx]->codecpar;
+				if (!s_same_codec(m_par_audio, codec_par))
+					item->codec_ctx_audio = open_decoder(codec_par, m_decoder_options);
+			}
+			if (item->v_idx >= 0)
+			{
+				const AVCodecParameters* codec_par = item->fmt_ctx->streams[item->v_idx]->codecpar;
+				if (!s_same_codec(m_par_video, codec_par))
+					item->codec_ctx_video = open_decoder(codec_par, m_decoder_options);
+				if (!m_live)
+					item->index = (std::unique_ptr<KeyframeIndex>)(new KeyframeIndex(fn.c_str(), item->v_idx));
+			}
+			return item;
+		}
+
+		static void thread_prepare(Playlist* self)
+		{
+			// files that fail to open are skipped
+			while (true)
+			{
+				std::string fn;
+				uint64_t generation;
+				{
+					std::unique_lock<std::mutex> lock(self->m_mutex);
+					if (self->m_files.empty()) break;
+					fn = self->m_files.front();
+					self->m_files.pop_front();
+					generation = self->m_generation;
+				}
+
+				// m_par_audio/m_par_video only change once this thread is done
+				std::unique_ptr<Item> item = (std::unique_ptr<Item>)(self->_open(fn));
+				if (item != nullptr)
+				{
+					std::unique_lock<std::mutex> lock(self->m_mutex);
+					if (generation == self->m_generation)
+						self->m_next = std::move(item);
+					break;
+				}
+			}
+
+			std::unique_lock<std::mutex> lock(self->m_mutex);
+			self->m_preparing = false;
+			self->m_prepared.notify_all();
+		}
 	};
 
+
+	// Audio is decoded by a worker thread into a PCM ring, kept ahead of the device. The device callback
+	// runs on a real-time thread and only copies out of the ring, so a slow packet or decoder call
+	// cannot glitch the output. When the ring runs short, the callback plays silence and counts an underrun.
 	class Player::AudioPlayback
 	{
 	public:
-		AudioPlayback(int audioDevId, Player* player) : m_player(player)
+		AudioPlayback(int audioDevId, Player* player) : m_player(player), m_gate(1)
 		{
-			m_p_packet = std::unique_ptr<AVPacket>(new AVPacket);
-			m_packet_ref = false;
-			m_audio_out = (std::unique_ptr<AudioOut>)(new AudioOut(audioDevId, player->m_p_codec_ctx_audio->sample_rate, callback, eof_callback, this));
-
+			m_p_packet = av_packet_alloc();
+			if (player->m_rate != 1.0)
+				_build_tempo(player->m_rate, player->m_audio_sample_rate);
+			m_thread_decode = (std::unique_ptr<std::thread>)(new std::thread(thread_decode, this));
+			m_audio_out = (std::unique_ptr<AudioOut>)(new AudioOut(audioDevId, player->m_audio_sample_rate, callback, eof_callback, this));
 		}
 
 
 		~AudioPlayback()
 		{
+			// m_audio_playing has been cleared by the owner
 			m_audio_out = nullptr;
+			m_gate.Close();
+			m_player->m_audio_ring->Wake();
+			m_thread_decode->join();
+			av_packet_free(&m_p_packet);
+			av_frame_free(&m_tempo_frame);
+			avfilter_graph_free(&m_tempo_graph);
+		}
+
+		// holds the decoder thread while the device plays silence, see Player::_seek_live()
+		void Pause()
+		{
+			m_paused = true;
+			m_player->m_audio_playing = false;
+			m_player->m_queue_audio->Wake();
+			m_player->m_audio_ring->Wake();
+		}
+
+		void WaitPaused()
+		{
+			m_gate.WaitParked();
+		}
 
-			if (m_packet_ref)
+		// the owner has flushed the decoder and cleared the queue and the ring meanwhile
+		void Resume()
+		{
+			m_eof = false;
+			m_primed = false;
+			m_sync_count = 0;
+			if (m_tempo_graph != nullptr)
 			{
-				av_packet_unref(m_p_packet.get());
-				m_packet_ref = false;
+				av_frame_free(&m_tempo_frame);
+				avfilter_graph_free(&m_tempo_graph);
+				m_tempo_start = -1;
+				m_tempo_in_samples = 0;
+				m_tempo_out_samples = 0;
+				_build_tempo(m_player->m_rate, m_player->m_audio_sample_rate);
 			}
+			m_player->m_audio_playing = true;
+			m_paused = false;
+			m_gate.Release();
 		}
 
 	private:
 		Player* m_player;
 		std::unique_ptr<AudioOut> m_audio_out;
+		std::unique_ptr<std::thread> m_thread_decode;
+		PauseGate m_gate;
+		AVPacket* m_p_packet;
 
+		bool m_paused = false;
 		bool m_eof = false;
-		bool m_packet_ref = false;
-		std::unique_ptr<AVPacket> m_p_packet;
-		int m_in_pos = 0;
-		int m_in_length = 0;
-		int m_in_buf_size = 0;
-
+		bool m_primed = false;
 		int m_sync_count = 0;
 
-		static void eof_callback(void* usr_ptr)
+		// time-stretch for rates other than 1
+		AVFilterGraph* m_tempo_graph = nullptr;
+		AVFilterContext* m_tempo_src = nullptr;
+		AVFilterContext* m_tempo_sink = nullptr;
+		AVFrame* m_tempo_frame = nullptr;
+		int64_t m_tempo_start = -1; // media time of the first sample fed
+		int64_t m_tempo_in_samples = 0;
+		int64_t m_tempo_out_samples = 0;
+
+		void _build_tempo(double rate, int sample_rate)
 		{
-			AudioPlayback* self = (AudioPlayback*)usr_ptr;
-			Player* player = self->m_player;
-			player->m_audio_eof = true;
+			m_tempo_graph = avfilter_graph_alloc();
+			char args[256];
+			snprintf(args, sizeof(args), "time_base=1/%d:sample_rate=%d:sample_fmt=s16:channel_layout=stereo", sample_rate, sample_rate);
+			avfilter_graph_create_filter(&m_tempo_src, avfilter_get_by_name("abuffer"), "in", args, nullptr, m_tempo_graph);
+			avfilter_graph_create_filter(&m_tempo_sink, avfilter_get_by_name("abuffersink"), "out", nullptr, nullptr, m_tempo_graph);
+
+			// atempo takes factors from 0.5 to 2, larger changes are chained
+			std::string chain;
+			while (rate > 2.0)
+			{
+				chain += "atempo=2,";
+				rate /= 2.0;
+			}
+			while (rate < 0.5)
+			{
+				chain += "atempo=0.5,";
+				rate /= 0.5;
+			}
+			snprintf(args, sizeof(args), "atempo=%f,aformat=sample_fmts=s16:channel_layouts=stereo", rate);
+			chain += args;
+
+			AVFilterInOut* outputs = avfilter_inout_alloc();
+			outputs->name = av_strdup("in");
+			outputs->filter_ctx = m_tempo_src;
+			outputs->pad_idx = 0;
+			outputs->next = nullptr;
+			AVFilterInOut* inputs = avfilter_inout_alloc();
+			inputs->name = av_strdup("out");
+			inputs->filter_ctx = m_tempo_sink;
+			inputs->pad_idx = 0;
+			inputs->next = nullptr;
+			avfilter_graph_parse_ptr(m_tempo_graph, chain.c_str(), &inputs, &outputs, nullptr);
+			avfilter_inout_free(&inputs);
+			avfilter_inout_free(&outputs);
+			avfilter_graph_config(m_tempo_graph, nullptr);
+
+			m_tempo_frame = av_frame_alloc();
 		}
 
-		static bool callback(short* buf, size_t buf_size, void* usr_ptr)
+		bool _write_ring(const short* data, size_t size, int64_t end_time)
+		{
+			PcmRing& ring = *m_player->m_audio_ring;
+			size_t pos = 0;
+			while (pos < size)
+			{
+				if (!ring.WaitSpace(size - pos, m_player->m_audio_playing)) return false;
+				pos += ring.Write(data + pos * 2, size - pos, end_time);
+			}
+			return true;
+		}
+
+		// 'data' == nullptr flushes the filter at the end of the stream
+		bool _write_tempo(const short* data, int size, int64_t start_time)
+		{
+			Player* player = m_player;
+			int sample_rate = player->m_audio_sample_rate;
+			if (data != nullptr)
+			{
+				if (m_tempo_start < 0) m_tempo_start = start_time;
+
+				AVFrame* frame = av_frame_alloc();
+				frame->format = AV_SAMPLE_FMT_S16;
+				frame->channel_layout = AV_CH_LAYOUT_STEREO;
+				frame->channels = 2;
+				frame->sample_rate = sample_rate;
+				frame->nb_samples = size;
+				av_frame_get_buffer(frame, 0);
+				memcpy(frame->data[0], data, sizeof(short) * size * 2);
+				frame->pts = m_tempo_in_samples;
+				m_tempo_in_samples += size;
+				av_buffersrc_add_frame(m_tempo_src, frame);
+				av_frame_free(&frame);
+			}
+			else
+			{
+				av_buffersrc_add_frame(m_tempo_src, nullptr);
+			}
+
+			// the output is timed by how much input it stands for
+			while (av_buffersink_get_frame(m_tempo_sink, m_tempo_frame) >= 0)
+			{
+				int out_size = m_tempo_frame->nb_samples;
+				m_tempo_out_samples += out_size;
+				int64_t end_time = -1;
+				if (m_tempo_start >= 0)
+					end_time = m_tempo_start + (int64_t)((double)m_tempo_out_samples * player->m_rate * AV_TIME_BASE / sample_rate);
+				bool written = _write_ring((const short*)m_tempo_frame->data[0], out_size, end_time);
+				av_frame_unref(m_tempo_frame);
+				if (!written) return false;
+			}
+			return true;
+		}
+
+		// moves every frame the decoder has ready into the ring
+		bool _receive_frames()
+		{
+			Player* player = m_player;
+			while (avcodec_receive_frame(player->m_p_codec_ctx_audio, player->m_p_frm_raw_audio) == 0)
+			{
+				AVFrame* frame = player->m_p_frm_raw_audio;
+				int in_length = frame->nb_samples;
+				int out_length = swr_get_out_samples(player->m_swr_ctx, in_length);
+				if (player->m_audio_buffer == nullptr || out_length > player->m_audio_buffer->len())
+				{
+					player->m_audio_buffer = (std::unique_ptr<AudioBuffer>)(new AudioBuffer(2, out_length));
+					av_samples_fill_arrays(player->m_p_frm_s16_audio->data, player->m_p_frm_s16_audio->linesize,
+						player->m_audio_buffer->data(), 2, out_length, AV_SAMPLE_FMT_S16, 0);
+				}
+				out_length = swr_convert(player->m_swr_ctx, player->m_p_frm_s16_audio->data, out_length,
+					(const uint8_t **)frame->data, in_length);
+
+				int64_t end_time = -1;
+				int64_t t = frame->best_effort_timestamp != AV_NOPTS_VALUE ? frame->best_effort_timestamp : frame->pkt_dts;
+				if (t != AV_NOPTS_VALUE)
+				{
+					end_time = t * player->m_audio_time_base_num * AV_TIME_BASE / player->m_audio_time_base_den;
+					end_time += (int64_t)in_length * AV_TIME_BASE / player->m_p_codec_ctx_audio->sample_rate;
+				}
+				av_frame_unref(frame);
+
+				const short* p_in = (const short*)player->m_audio_buffer->data();
+				if (m_tempo_graph != nullptr)
+				{
+					int64_t start_time = end_time >= 0 ? end_time - (int64_t)in_length * AV_TIME_BASE / player->m_p_codec_ctx_audio->sample_rate : -1;
+					if (!_write_tempo(p_in, out_length, start_time)) return false;
+				}
+				else if (!_write_ring(p_in, (size_t)out_length, end_time))
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		// drops held packets further behind the newest than the video queue can read ahead, the first
+		// keyframe cannot be older than that
+		static void s_trim_held(std::deque<AVPacket*>& held, int time_base_num, int time_base_den)
+		{
+			int64_t newest = held.back()->dts;
+			if (newest == AV_NOPTS_VALUE) return;
+			int64_t window = (int64_t)PacketQueue::s_max_read_ahead * time_base_den / ((int64_t)time_base_num * AV_TIME_BASE);
+			while (held.size() > 1)
+			{
+				AVPacket* oldest = held.front();
+				if (oldest->stream_index == s_decoder_switch || oldest->dts == AV_NOPTS_VALUE || oldest->dts >= newest - window) break;
+				av_packet_free(&oldest);
+				held.pop_front();
+			}
+		}
+
+		static void thread_decode(AudioPlayback* self)
+		{
+			do
+			{
+				_decode(self);
+			} while (self->m_gate.Park());
+		}
+
+		static void _decode(AudioPlayback* self)
 		{
-			AudioPlayback* self = (AudioPlayback*)usr_ptr;
 			Player* player = self->m_player;
 			PacketQueue& queue = *player->m_queue_audio;
+			PcmRing& ring = *player->m_audio_ring;
 			int time_base_num = player->m_audio_time_base_num;
 			int time_base_den = player->m_audio_time_base_den;
 
-			bool eof = self->m_eof;
-			if (!player->m_audio_playing || eof)
+			// after a seek, the audio before the sync point is decoded but not played
+			bool skipping = ring.Available() == 0;
+
+			// fast-start: video sets the clock with its first keyframe, audio joins it from there. The packets
+			// until then are held here, as a full queue would keep the demuxer from reaching that keyframe
+			bool joining = skipping && player->m_fast_start && player->m_video_playback != nullptr;
+			std::deque<AVPacket*> held;
+			while (joining && !player->m_video_started && !player->m_video_eof)
 			{
-				memset(buf, 0, sizeof(short)*buf_size * 2);
-				return false;
+				AVPacket* packet = av_packet_alloc();
+				if (!queue.Pop(packet, player->m_audio_playing))
+				{
+					av_packet_free(&packet);
+					break;
+				}
+				held.push_back(packet);
+				s_trim_held(held, time_base_num, time_base_den);
 			}
 
-			int out_pos = 0;
-			int count_packet = 0;
-			int64_t progress = -1;
-			while (player->m_audio_playing && !eof && out_pos < buf_size)
+			while (true)
 			{
-				if (player->m_audio_buffer != nullptr && self->m_in_pos < self->m_in_length)
+				if (!held.empty() && player->m_audio_playing)
 				{
-					int copy_size = self->m_in_length - self->m_in_pos;
-					int copy_size_out = buf_size - out_pos;
-					if (copy_size > copy_size_out) copy_size = copy_size_out;
-					short* p_out = buf + out_pos * 2;
-					const short* p_in = (const short*)player->m_audio_buffer->data() + self->m_in_pos * 2;
-					memcpy(p_out, p_in, sizeof(short)*copy_size * 2);
-					out_pos += copy_size;
-					self->m_in_pos += copy_size;
+					av_packet_move_ref(self->m_p_packet, held.front());
+					av_packet_free(&held.front());
+					held.pop_front();
 				}
-				else
+				else if (!held.empty() || !queue.Pop(self->m_p_packet, player->m_audio_playing))
 				{
-					while (true)
+					break;
+				}
+
+				if (self->m_p_packet->stream_index == s_decoder_switch)
+				{
+					// the next file needs a decoder of its own, the current one is drained first
+					avcodec_send_packet(player->m_p_codec_ctx_audio, nullptr);
+					if (!self->_receive_frames()) break;
+					avcodec_free_context(&player->m_p_codec_ctx_audio);
+					player->m_p_codec_ctx_audio = player->m_playlist->PopDecoder(AVMEDIA_TYPE_AUDIO);
+					player->_open_resampler();
+					continue;
+				}
+
+				avcodec_send_packet(player->m_p_codec_ctx_audio, self->m_p_packet);
+				if (skipping || player->m_live)
+				{
+					int64_t progress = self->m_p_packet->dts * time_base_num * AV_TIME_BASE / time_base_den;
+					int64_t start = player->m_live_drop_until;
+					if (skipping)
+						start = joining ? (int64_t)player->_get_progress() : (int64_t)player->m_sync_progress;
+					if (progress < start)
 					{
-						int ret = avcodec_receive_frame(player->m_p_codec_ctx_audio, player->m_p_frm_raw_audio);
-						if (ret == 0)
-						{
-							self->m_in_length = player->m_p_frm_raw_audio->nb_samples;
-							if (player->m_audio_buffer == nullptr || self->m_in_length > self->m_in_buf_size)
-							{
-								self->m_in_buf_size = self->m_in_length;
-								player->m_audio_buffer = (std::unique_ptr<AudioBuffer>)(new AudioBuffer(2, self->m_in_buf_size));
-								av_samples_fill_arrays(player->m_p_frm_s16_audio->data, player->m_p_frm_s16_audio->linesize,
-									player->m_audio_buffer->data(), 2, self->m_in_buf_size, AV_SAMPLE_FMT_S16, 0);
-							}
-							swr_convert(player->m_swr_ctx, player->m_p_frm_s16_audio->data, self->m_in_length,
-								(const uint8_t **)player->m_p_frm_raw_audio->data, self->m_in_length);
-
-							self->m_in_pos = 0;
-							break;
-						}
-
-						if (self->m_packet_ref)
-						{
-							av_packet_unref(self->m_p_packet.get());
-							self->m_packet_ref = false;
-						}
-
-						while (player->m_audio_playing && !eof && queue.Size() == 0)
-						{
-							if (!player->m_demuxing) eof = true;
-						}
-						if (!player->m_audio_playing || eof) break;
-
-						*self->m_p_packet = queue.Pop();
-						self->m_packet_ref = true;
-
-						if (count_packet == 0)
-						{
-							while (true)
-							{
-								progress = self->m_p_packet->dts * time_base_num * AV_TIME_BASE / time_base_den;
-								if (progress >= player->m_sync_progress) break;
-
-								avcodec_send_packet(player->m_p_codec_ctx_audio, self->m_p_packet.get());
-								while (avcodec_receive_frame(player->m_p_codec_ctx_audio, player->m_p_frm_raw_audio) == 0);
-								av_packet_unref(self->m_p_packet.get());
-								self->m_packet_ref = false;
-
-								while (player->m_audio_playing && !eof && queue.Size() == 0)
-								{
-									if (!player->m_demuxing) eof = true;
-								}
-								if (!player->m_audio_playing || eof) break;
-								*self->m_p_packet = queue.Pop();
-								self->m_packet_ref = true;
-							}
-							if (!player->m_audio_playing || eof) break;
-						}
-
-						avcodec_send_packet(player->m_p_codec_ctx_audio, self->m_p_packet.get());
-						count_packet++;
+						av_packet_unref(self->m_p_packet);
+						while (avcodec_receive_frame(player->m_p_codec_ctx_audio, player->m_p_frm_raw_audio) == 0)
+							av_frame_unref(player->m_p_frm_raw_audio);
+						continue;
 					}
+					skipping = false;
+				}
+				av_packet_unref(self->m_p_packet);
+				if (!self->_receive_frames()) break;
+			}
+
+			for (size_t i = 0; i < held.size(); i++)
+				av_packet_free(&held[i]);
+
+			if (player->m_audio_playing)
+			{
+				// end of stream, drain the samples the decoder is still holding back
+				avcodec_send_packet(player->m_p_codec_ctx_audio, nullptr);
+				if (self->_receive_frames() && self->m_tempo_graph != nullptr)
+					self->_write_tempo(nullptr, 0, -1);
+				ring.SetEOF();
+			}
+		}
+
+		static void eof_callback(void* usr_ptr)
+		{
+			AudioPlayback* self = (AudioPlayback*)usr_ptr;
+			Player* player = self->m_player;
+			player->m_audio_eof = true;
+		}
+
+		static bool callback(short* buf, size_t buf_size, void* usr_ptr)
+		{
+			AudioPlayback* self = (AudioPlayback*)usr_ptr;
+			Player* player = self->m_player;
+			PcmRing& ring = *player->m_audio_ring;
+
+			// the device is kept open through seeks and past the end of the stream
+			if (self->m_paused || self->m_eof)
+			{
+				memset(buf, 0, sizeof(short)*buf_size * 2);
+				return true;
+			}
+			if (!player->m_audio_playing)
+			{
+				memset(buf, 0, sizeof(short)*buf_size * 2);
+				return false;
+			}
 
-					if (!player->m_audio_playing || eof) break;
+			if (player->m_live)
+			{
+				// after a catch-up, the samples behind the new clock go unheard
+				while (ring.Available() > 0)
+				{
+					int64_t t = ring.TimeAt(ring.ReadPosition());
+					if (t < 0 || t >= player->m_live_drop_until) break;
+					ring.Read(buf, min(buf_size, ring.Available()));
 				}
 			}
 
-			if (out_pos < buf_size)
+			uint64_t position = ring.ReadPosition();
+			size_t count = ring.Read(buf, buf_size);
+			if (count < buf_size)
 			{
-				short* p_out = buf + out_pos * 2;
-				size_t bytes = sizeof(short) * (buf_size - out_pos) * 2;
-				memset(p_out, 0, bytes);
+				memset(buf + count * 2, 0, sizeof(short) * (buf_size - count) * 2);
+				if (ring.IsEOF() && ring.Available() == 0)
+				{
+					self->m_eof = true;
+					player->m_audio_eof = true;
+				}
+				else if (self->m_primed)
+				{
+					// silence before the first samples arrive is start-up latency, not an underrun
+					player->m_audio_underruns++;
+					player->m_audio_underrun_samples += buf_size - count;
+				}
 			}
 
 			static int s_sync_interval = 10;
+			int64_t progress = -1;
+			if (count > 0)
+			{
+				if (!self->m_primed && player->m_first_audio == 0)
+					player->m_first_audio = time_micro_sec() - player->m_start_time;
+				self->m_primed = true;
+				progress = ring.TimeAt(position);
+			}
 			if (progress > 0)
-			{				
+			{
 				if (self->m_sync_count == 0)
 				{
 					uint64_t localtime = time_micro_sec();
@@ -263,94 +823,381 @@ namespace LiveKit
 				self->m_sync_count = (self->m_sync_count + 1) % s_sync_interval;
 			}
 
-			self->m_eof = eof;
 			return true;
 		}
 	};
 
+	// Video runs as a pipeline of three threads, so that decoding and pixel conversion happen ahead
+	// of presentation instead of delaying it:
+	// decode: packets -> decoded AVFrames (recycled through a pool)
+	// convert: AVFrames -> Images, skipping frames that are already late when a newer one is waiting
+	// present: waits for each Image's time on the playback clock and hands it to the targets
 	class Player::VideoPlayback
 	{
 	public:
-		VideoPlayback(Player* player) : m_player(player)
+		VideoPlayback(Player* player) : m_player(player), m_gate(3), m_free_frames(s_num_frames), m_decoded_frames(s_num_frames), m_ready_images(s_num_images)
 		{
-			m_thread_read = (std::unique_ptr<std::thread>)(new std::thread(thread_read, this));
+			// the decoder may still hold frames from before a seek, or be drained from reaching the end
+			avcodec_flush_buffers(player->m_p_codec_ctx_video);
+
+			m_p_packet = av_packet_alloc();
+			for (int i = 0; i < s_num_frames; i++)
+			{
+				m_frames[i] = av_frame_alloc();
+				m_free_frames.Push(m_frames[i], player->m_video_playing);
+			}
+
+			m_thread_decode = (std::unique_ptr<std::thread>)(new std::thread(thread_decode, this));
+			m_thread_convert = (std::unique_ptr<std::thread>)(new std::thread(thread_convert, this));
+			m_thread_present = (std::unique_ptr<std::thread>)(new std::thread(thread_present, this));
 		}
 
 
 		~VideoPlayback()
 		{
-			m_thread_read->join();
+			// m_video_playing has been cleared by the owner
+			m_gate.Close();
+			m_free_frames.Wake();
+			m_decoded_frames.Wake();
+			m_ready_images.Wake();
+			m_thread_present->join();
+			m_thread_convert->join();
+			m_thread_decode->join();
+
+			for (int i = 0; i < s_num_frames; i++)
+				av_frame_free(&m_frames[i]);
+			av_packet_free(&m_p_packet);
+		}
+
+		// holds the three threads, see Player::_seek_live()
+		void Pause()
+		{
+			m_player->m_video_playing = false;
+			m_player->m_queue_video->Wake();
+			m_free_frames.Wake();
+			m_decoded_frames.Wake();
+			m_ready_images.Wake();
+			m_player->m_video_pacer->interrupt();
+		}
+
+		void WaitPaused()
+		{
+			m_gate.WaitParked();
+		}
+
+		// the owner has flushed the decoder and cleared the queue meanwhile
+		void Resume()
+		{
+			// frames may have been left with any of the stages, the pool starts over
+			m_free_frames.Clear();
+			m_decoded_frames.Clear();
+			m_ready_images.Clear();
+			m_player->m_video_playing = true;
+			for (int i = 0; i < s_num_frames; i++)
+			{
+				av_frame_unref(m_frames[i]);
+				m_free_frames.Push(m_frames[i], m_player->m_video_playing);
+			}
+			m_gate.Release();
 		}
 
 	private:
-		Player* m_player;
-		std::unique_ptr<std::thread> m_thread_read;
+		struct ReadyImage
+		{
+			std::vector<ImageRef> images; // one per target
+			int64_t time;
+		};
+
+		static const int s_num_frames = 4;
+		static const int s_num_images = 3;
 
-		static void thread_read(VideoPlayback* self)
+		Player* m_player;
+		PauseGate m_gate;
+		AVPacket* m_p_packet;
+		AVFrame* m_frames[s_num_frames];
+		StageQueue<AVFrame*> m_free_frames;
+		StageQueue<AVFrame*> m_decoded_frames;
+		StageQueue<ReadyImage> m_ready_images;
+
+		std::unique_ptr<std::thread> m_thread_decode;
+		std::unique_ptr<std::thread> m_thread_convert;
+		std::unique_ptr<std::thread> m_thread_present;
+
+		int64_t _frame_time(const AVFrame* frame) const
 		{
-			Player* player = (Player*)self->m_player;
-			PacketQueue& queue = *player->m_queue_video;
+			int64_t t = frame->best_effort_timestamp != AV_NOPTS_VALUE ? frame->best_effort_timestamp : frame->pkt_dts;
+			return t * m_player->m_video_time_base_num * AV_TIME_BASE / m_player->m_video_time_base_den;
+		}
 
-			int time_base_num = player->m_video_time_base_num;
-			int time_base_den = player->m_video_time_base_den;
+		// moves every frame the decoder has ready to the decoded queue
+		bool _receive_frames()
+		{
+			Player* player = m_player;
+			while (true)
+			{
+				AVFrame* frame;
+				if (!m_free_frames.Pop(&frame, player->m_video_playing)) return false;
+				if (avcodec_receive_frame(player->m_p_codec_ctx_video, frame) != 0)
+				{
+					m_free_frames.Push(frame, player->m_video_playing);
+					return true;
+				}
+				if (player->m_video_shed_level > 0)
+					player->m_video_shed_received++;
+				if (!m_decoded_frames.Push(frame, player->m_video_playing))
+				{
+					av_frame_unref(frame);
+					return false;
+				}
+			}
+		}
 
-			while (player->m_video_playing && !player->m_video_eof)
+		static void thread_decode(VideoPlayback* self)
+		{
+			do
 			{
-				uint64_t localtime, progress;
-				player->_get_sync_point(localtime, progress);
-				uint64_t t = time_micro_sec();
-				int64_t cur_progress = progress + (t - localtime);
+				_decode(self);
+			} while (self->m_gate.Park());
+		}
+
+		// trades decoding quality for speed while the packets being decoded are behind the clock,
+		// full quality is restored once decoding is ahead again
+		void _shed(int64_t lateness)
+		{
+			Player* player = m_player;
+			int level = player->m_video_shed_level;
+			if (lateness <= 0) level = 0;
+			else if (lateness >= s_shed_loop_filter_lateness) level = 2;
+			else if (lateness >= s_shed_nonref_lateness) level = max(level, 1);
+			_set_shed_level(level);
+		}
 
-				while (player->m_video_playing && !player->m_video_eof && queue.Size() == 0)
+		void _set_shed_level(int level)
+		{
+			Player* player = m_player;
+			if (level == player->m_video_shed_level) return;
+			s_apply_shedding(player->m_p_codec_ctx_video, level, player->m_decoder_options);
+			uint64_t now = time_micro_sec();
+			if (player->m_video_shed_level == 0)
+				player->m_video_shed_start = now;
+			else if (level == 0)
+				player->m_video_shedding_time += now - player->m_video_shed_start;
+			player->m_video_shed_level = level;
+		}
+
+		static void _decode(VideoPlayback* self)
+		{
+			Player* player = self->m_player;
+			PacketQueue& queue = *player->m_queue_video;
+			bool keyframe_seen = false;
+
+			while (queue.Pop(self->m_p_packet, player->m_video_playing))
+			{
+				if (self->m_p_packet->stream_index == s_decoder_switch)
 				{
-					if (!player->m_demuxing)
-						player->m_video_eof = true;
+					// the next file needs a decoder of its own, the current one is drained first
+					avcodec_send_packet(player->m_p_codec_ctx_video, nullptr);
+					if (!self->_receive_frames()) break;
+					avcodec_free_context(&player->m_p_codec_ctx_video);
+					player->m_p_codec_ctx_video = player->m_playlist->PopDecoder(AVMEDIA_TYPE_VIDEO);
+					player->m_video_width = player->m_p_codec_ctx_video->width;
+					player->m_video_height = player->m_p_codec_ctx_video->height;
+					s_apply_shedding(player->m_p_codec_ctx_video, player->m_video_shed_level, player->m_decoder_options);
+					continue;
 				}
-				if (!player->m_video_playing || player->m_video_eof) break;
 
-				AVPacket packet = queue.Front();
-				int64_t t_next_frame = packet.dts * time_base_num * AV_TIME_BASE / time_base_den;
-				if (t_next_frame > cur_progress)
+				// live: what is behind the clock is not decoded, decoding resumes with a keyframe
+				if (player->m_live && self->m_p_packet->dts != AV_NOPTS_VALUE)
 				{
-					std::this_thread::sleep_for(std::chrono::microseconds(t_next_frame - cur_progress));
+					int64_t progress = self->m_p_packet->dts * player->m_video_time_base_num * AV_TIME_BASE / player->m_video_time_base_den;
+					if (progress < player->m_live_drop_until && (self->m_p_packet->flags & AV_PKT_FLAG_KEY) == 0)
+					{
+						av_packet_unref(self->m_p_packet);
+						keyframe_seen = false;
+						continue;
+					}
 				}
-				else
+
+				// joining a stream between keyframes only decodes to garbage until the next one
+				if ((player->m_fast_start || player->m_live) && !keyframe_seen)
 				{
-					while (true)
+					if ((self->m_p_packet->flags & AV_PKT_FLAG_KEY) == 0)
 					{
-						packet = queue.Pop();
-						avcodec_send_packet(player->m_p_codec_ctx_video, &packet);
-						avcodec_receive_frame(player->m_p_codec_ctx_video, player->m_p_frm_raw_video);
-						av_packet_unref(&packet);
-
-						if (queue.Size() == 0) break;
-						AVPacket next_packet = queue.Front();
-						t_next_frame = next_packet.dts * time_base_num * AV_TIME_BASE / time_base_den;
-						if (t_next_frame > cur_progress) break;
+						av_packet_unref(self->m_p_packet);
+						continue;
 					}
+					keyframe_seen = true;
+				}
 
-					sws_scale(player->m_sws_ctx, (const uint8_t *const *)player->m_p_frm_raw_video->data, player->m_p_frm_raw_video->linesize,
-						0, player->m_p_codec_ctx_video->height, player->m_p_frm_bgr_video->data, player->m_p_frm_bgr_video->linesize);
+				// every frame is wanted in free-run, and fast-start has no clock before the first frame
+				bool clocked = !player->m_free_run && (!player->m_fast_start || player->m_video_started);
+				if (clocked && self->m_p_packet->dts != AV_NOPTS_VALUE)
+				{
+					int64_t progress = self->m_p_packet->dts * player->m_video_time_base_num * AV_TIME_BASE / player->m_video_time_base_den;
+					self->_shed((int64_t)player->_get_progress() - progress);
+				}
+				if (player->m_video_shed_level > 0)
+					player->m_video_shed_sent++;
+
+				avcodec_send_packet(player->m_p_codec_ctx_video, self->m_p_packet);
+				av_packet_unref(self->m_p_packet);
+				if (!self->_receive_frames()) break;
+			}
 
-					for (size_t i = 0; i < player->m_targets.size(); i++)
+			if (player->m_video_playing)
+			{
+				// end of stream, drain the frames the decoder is still holding back
+				avcodec_send_packet(player->m_p_codec_ctx_video, nullptr);
+				self->_receive_frames();
+			}
+			self->_set_shed_level(0);
+			self->m_decoded_frames.SetEOF();
+		}
+
+		static void thread_convert(VideoPlayback* self)
+		{
+			do
+			{
+				_convert(self);
+			} while (self->m_gate.Park());
+		}
+
+		static void _convert(VideoPlayback* self)
+		{
+			Player* player = self->m_player;
+
+			AVFrame* frame;
+			while (self->m_decoded_frames.Pop(&frame, player->m_video_playing))
+			{
+				int64_t t = self->_frame_time(frame);
+
+				int64_t cur_progress = (int64_t)player->_get_progress();
+
+				// no point scaling a frame that will not be shown: the next one is already due,
+				// unless every frame is wanted
+				AVFrame* next;
+				bool superseded = !player->m_free_run && t < cur_progress &&
+					self->m_decoded_frames.TryPeek(&next) && self->_frame_time(next) <= cur_progress;
+				if (!superseded)
+				{
+					ReadyImage ready;
+					player->_convert_video_frame(frame, ready.images);
+					ready.time = t;
+					self->m_ready_images.Push(ready, player->m_video_playing);
+				}
+				else
+				{
+					player->m_video_shed_convert++;
+				}
+
+				av_frame_unref(frame);
+				self->m_free_frames.Push(frame, player->m_video_playing);
+			}
+			self->m_ready_images.SetEOF();
+		}
+
+		static void thread_present(VideoPlayback* self)
+		{
+			do
+			{
+				_present(self);
+			} while (self->m_gate.Park());
+		}
+
+		static void _present(VideoPlayback* self)
+		{
+			Player* player = self->m_player;
+
+			ReadyImage ready;
+			while (self->m_ready_images.Pop(&ready, player->m_video_playing))
+			{
+				if (player->m_free_run)
+				{
+					// as fast as the targets accept, the clock follows the frames
+					self->_present(ready);
+					player->_set_sync_point(time_micro_sec(), ready.time);
+					continue;
+				}
+
+				if (player->m_fast_start && !player->m_video_started)
+				{
+					// the first keyframe is shown as soon as it decodes, the clock starts from it
+					// unless audio is already running
+					self->_present(ready);
+					if (player->m_first_audio == 0)
+						player->_set_sync_point(time_micro_sec(), ready.time);
+					player->m_video_started = true;
+					continue;
+				}
+
+				while (player->m_video_playing)
+				{
+					uint64_t t = time_micro_sec();
+					int64_t cur_progress = (int64_t)player->_get_progress(t);
+
+					// skip to the newest image that is due
+					ReadyImage next;
+					while (self->m_ready_images.TryPeek(&next) && next.time <= cur_progress)
 					{
-						player->m_targets[i]->write_image(player->m_video_buffer.get());
+						self->m_ready_images.Pop(&ready, player->m_video_playing);
+						player->m_video_shed_present++;
 					}
-				
+
+					if (ready.time <= cur_progress) break;
+
+					// the sync point may move meanwhile, so the image is re-checked after waking up
+					player->m_video_pacer->wait_until(t + (uint64_t)((double)(ready.time - cur_progress) / player->m_rate));
 				}
+				if (!player->m_video_playing) break;
+
+				self->_present(ready);
 			}
 			player->m_video_eof = true;
 		}
+
+		void _present(const ReadyImage& ready)
+		{
+			m_player->_present_video_frame(ready.images);
+			if (m_player->m_first_video_frame == 0)
+				m_player->m_first_video_frame = time_micro_sec() - m_player->m_start_time;
+		}
 	};
 
 
-	Player::Player(const char* fn, bool play_audio, bool play_video, int audio_device_id) : m_audio_device_id(audio_device_id)
+	Player::Player(const char* fn, bool play_audio, bool play_video, int audio_device_id, bool fast_start, bool live, const DecoderOptions& decoder_options)
+		: m_audio_device_id(audio_device_id), m_fast_start(fast_start), m_live(live), m_decoder_options(decoder_options)
 	{
-		if (!exists_test(fn))
+		if (live)
+		{
+			// frame threading holds back a frame per thread
+			m_decoder_options.low_delay = true;
+			if (m_decoder_options.thread_type == DecoderThreading::Default)
+				m_decoder_options.thread_type = DecoderThreading::Slice;
+		}
+
+		if (!live && !exists_test(fn))
 			printf("Failed loading %s\n", fn);
 
-		avformat_open_input(&m_p_fmt_ctx, fn, nullptr, nullptr);
-		avformat_find_stream_info(m_p_fmt_ctx, nullptr);
+		uint64_t t_open = time_micro_sec();
+		AVDictionary* options = nullptr;
+		if (fast_start || live)
+		{
+			av_dict_set_int(&options, "probesize", s_fast_probesize, 0);
+			av_dict_set_int(&options, "analyzeduration", s_fast_analyze_duration, 0);
+		}
+		if (live)
+		{
+			// packets go out as soon as they are read, instead of after a look-ahead of the input
+			av_dict_set(&options, "fflags", "nobuffer", 0);
+		}
+		avformat_open_input(&m_p_fmt_ctx, fn, nullptr, &options);
+		av_dict_free(&options);
+		uint64_t t_find = time_micro_sec();
+		m_startup_timings.open_input = t_find - t_open;
+
+		find_stream_info(m_p_fmt_ctx, m_decoder_options);
+		uint64_t t_decoders = time_micro_sec();
+		m_startup_timings.find_stream_info = t_decoders - t_find;
 
 		m_duration = m_p_fmt_ctx->duration;
 
@@ -370,55 +1217,77 @@ namespace LiveKit
 			}
 		}
 
-		// audio
+		// in fast-start mode, the audio decoder is opened alongside the video decoder
+		auto open_audio = [this]()
+		{
+			uint64_t t = time_micro_sec();
+			m_p_codec_ctx_audio = open_decoder(m_p_fmt_ctx->streams[m_a_idx]->codecpar, m_decoder_options);
+			m_startup_timings.open_audio_decoder = time_micro_sec() - t;
+		};
+		std::unique_ptr<std::thread> thread_open_audio;
 		if (m_a_idx >= 0)
 		{
-			AVCodecParameters* p_codec_par = m_p_fmt_ctx->streams[m_a_idx]->codecpar;
-			AVCodec* p_codec = avcodec_find_decoder(p_codec_par->codec_id);
-			m_p_codec_ctx_audio = avcodec_alloc_context3(p_codec);
-			avcodec_parameters_to_context(m_p_codec_ctx_audio, p_codec_par);
-			avcodec_open2(m_p_codec_ctx_audio, p_codec, nullptr);
-
-			m_p_frm_raw_audio = av_frame_alloc();
-			m_p_frm_s16_audio = av_frame_alloc();
-
-			int64_t layout_in = av_get_default_channel_layout(m_p_codec_ctx_audio->channels);
-			m_swr_ctx = swr_alloc_set_opts(nullptr, AV_CH_LAYOUT_STEREO, AV_SAMPLE_FMT_S16, m_p_codec_ctx_audio->sample_rate,
-				layout_in, m_p_codec_ctx_audio->sample_fmt, m_p_codec_ctx_audio->sample_rate, 0, nullptr);
-			swr_init(m_swr_ctx);
+			if (fast_start && m_v_idx >= 0)
+				thread_open_audio = (std::unique_ptr<std::thread>)(new std::thread(open_audio));
+			else
+				open_audio();
 		}
 
 		// video
 		if (m_v_idx >= 0)
 		{
-			AVCodecParameters* p_codec_par = m_p_fmt_ctx->streams[m_v_idx]->codecpar;
-			AVCodec* p_codec = avcodec_find_decoder(p_codec_par->codec_id);
-			m_p_codec_ctx_video = avcodec_alloc_context3(p_codec);
-			avcodec_parameters_to_context(m_p_codec_ctx_video, p_codec_par);
-			avcodec_open2(m_p_codec_ctx_video, p_codec, nullptr);
+			uint64_t t = time_micro_sec();
+			m_p_codec_ctx_video = open_decoder(m_p_fmt_ctx->streams[m_v_idx]->codecpar, m_decoder_options);
+			m_startup_timings.open_video_decoder = time_micro_sec() - t;
 
 			m_p_frm_raw_video = av_frame_alloc();
-			m_p_frm_bgr_video = av_frame_alloc();
 
 			m_video_width = m_p_codec_ctx_video->width;
 			m_video_height = m_p_codec_ctx_video->height;
-			m_video_buffer = (std::unique_ptr<Image>)(new Image(m_video_width, m_video_height));
+			m_video_format = ImageConverter::s_native_format(m_p_codec_ctx_video->pix_fmt);
+			m_video_outputs = (std::unique_ptr<TargetConverter>)(new TargetConverter(m_video_format));
+			m_video_pacer = (std::unique_ptr<FramePacer>)(new FramePacer);
+
+			// a scan would compete with playback for the input, fast-start leaves it to the first seek.
+			// A live input has no end to scan to, the scan would hold a second connection open for good
+			if (!fast_start && !live)
+				m_video_index = (std::unique_ptr<KeyframeIndex>)(new KeyframeIndex(fn, m_v_idx));
+		}
+
+		// audio
+		if (thread_open_audio != nullptr)
+			thread_open_audio->join();
+		m_startup_timings.open_decoders = time_micro_sec() - t_decoders;
 
-			av_image_fill_arrays(m_p_frm_bgr_video->data, m_p_frm_bgr_video->linesize, m_video_buffer->data(), AV_PIX_FMT_BGR24, m_video_width, m_video_height, 1);
-			m_sws_ctx = sws_getContext(m_video_width, m_video_height, m_p_codec_ctx_video->pix_fmt, m_video_width, m_video_height, AV_PIX_FMT_BGR24, SWS_BICUBIC, nullptr, nullptr, nullptr);		
+		if (m_a_idx >= 0)
+		{
+			m_p_frm_raw_audio = av_frame_alloc();
+			m_p_frm_s16_audio = av_frame_alloc();
+
+			// the device keeps the first file's rate, later files of the playlist are resampled to it
+			m_audio_sample_rate = m_p_codec_ctx_audio->sample_rate;
+			_open_resampler();
+
+			// decoded audio kept ahead of the device
+			int sample_rate = m_audio_sample_rate;
+			m_audio_ring = (std::unique_ptr<PcmRing>)(new PcmRing((size_t)sample_rate * s_audio_ring_duration / 1000000, sample_rate));
 		}
 
 		if (m_a_idx >= 0)
 		{
-			m_queue_audio = (std::unique_ptr<PacketQueue>)(new PacketQueue(42));
+			m_queue_audio = (std::unique_ptr<PacketQueue>)(new PacketQueue(s_audio_queue_bytes, m_audio_time_base_num, m_audio_time_base_den));
 		}
 
 		if (m_v_idx >= 0)
 		{
-			m_queue_video = (std::unique_ptr<PacketQueue>)(new PacketQueue(30));
+			m_queue_video = (std::unique_ptr<PacketQueue>)(new PacketQueue(s_video_queue_bytes, m_video_time_base_num, m_video_time_base_den));
 		}
 
 		m_p_packet = std::unique_ptr<AVPacket>(new AVPacket);
+		m_a_stream = m_a_idx;
+		m_v_stream = m_v_idx;
+		m_playlist = (std::unique_ptr<Playlist>)(new Playlist(this, fn));
+		m_fn = fn;
 
 		InitializeCriticalSectionAndSpinCount(&m_cs_sync, 0x00000400);
 
@@ -428,12 +1297,11 @@ namespace LiveKit
 	Player::~Player()
 	{
 		stop();
+		m_playlist = nullptr;
 		DeleteCriticalSection(&m_cs_sync);
 
 		if (m_v_idx >= 0)
 		{
-			sws_freeContext(m_sws_ctx);
-			av_frame_free(&m_p_frm_bgr_video);
 			av_frame_free(&m_p_frm_raw_video);
 			avcodec_free_context(&m_p_codec_ctx_video);
 		}
@@ -472,53 +1340,151 @@ namespace LiveKit
 		}
 		else
 		{
-			uint64_t localtime, progress;
-			_get_sync_point(localtime, progress);
-			return progress + (time_micro_sec() - localtime);
+			// relative to the file of the playlist being played
+			uint64_t progress = _get_progress();
+			int64_t pos = (int64_t)progress - m_playlist->OffsetAt(progress);
+			return pos > 0 ? (uint64_t)pos : 0;
+		}
+	}
+
+	uint64_t Player::_get_progress(uint64_t now) const
+	{
+		uint64_t localtime, progress;
+		_get_sync_point(localtime, progress);
+		if (m_free_run) return progress;
+		if (now == 0) now = time_micro_sec();
+		if (m_rate == 1.0) return progress + (now - localtime);
+		return progress + (uint64_t)((double)(now - localtime) * m_rate);
+	}
+
+
+	void Player::get_pacing_stats(PacingStats* stats) const
+	{
+		if (m_video_pacer != nullptr)
+			*stats = m_video_pacer->get_stats();
+		else
+			*stats = PacingStats();
+	}
+
+	void Player::get_queue_stats(PacketQueueStats* audio, PacketQueueStats* video) const
+	{
+		*audio = m_a_idx >= 0 ? m_queue_audio->GetStats() : PacketQueueStats();
+		*video = m_v_idx >= 0 ? m_queue_video->GetStats() : PacketQueueStats();
+	}
+
+	void Player::get_audio_stats(AudioPlaybackStats* stats) const
+	{
+		*stats = AudioPlaybackStats();
+		if (m_a_idx >= 0)
+		{
+			stats->underruns = m_audio_underruns;
+			stats->underrun_samples = m_audio_underrun_samples;
+			stats->buffered_samples = m_audio_ring->Available();
+			stats->capacity_samples = m_audio_ring->Capacity();
 		}
 	}
 
+	void Player::get_video_stats(VideoPlaybackStats* stats) const
+	{
+		*stats = VideoPlaybackStats();
+		if (m_v_idx >= 0)
+		{
+			// frames are received a little after their packets, the difference settles once shedding ends
+			uint64_t received = m_video_shed_received;
+			uint64_t sent = m_video_shed_sent;
+			if (sent > received)
+				stats->shed_decode = sent - received;
+			stats->shed_convert = m_video_shed_convert;
+			stats->shed_present = m_video_shed_present;
+			// the start is stored before the level rises
+			stats->shed_level = m_video_shed_level;
+			stats->shedding_time = m_video_shedding_time;
+			if (stats->shed_level > 0)
+				stats->shedding_time += time_micro_sec() - m_video_shed_start;
+		}
+	}
 
 	void Player::stop()
 	{
 		if (m_thread_demux != nullptr)
 		{
+			// still playing a file the demuxer has already left, go on with the next one from its start
 			uint64_t pos = get_position();
+			bool last = true;
+			m_playlist->OffsetAt(_get_progress(), &last);
+			if (!last) pos = 0;
 
 			m_demuxing = false;
 			m_audio_playing = false;
 			m_video_playing = false;
+			if (m_a_idx >= 0) m_queue_audio->Wake();
+			if (m_v_idx >= 0) m_queue_video->Wake();
+
 			m_audio_playback = nullptr;
 			m_video_playback = nullptr;
-
-			while (m_a_idx >= 0 && m_queue_audio->Size() > 0)
-			{
-				AVPacket packet = m_queue_audio->Pop();
-				av_packet_unref(&packet);
-			}
-
-			while (m_v_idx >= 0 && m_queue_video->Size() > 0)
-			{
-				AVPacket packet = m_queue_video->Pop();
-				av_packet_unref(&packet);
-			}
-
+			m_demux_gate->Close();
 			m_thread_demux->join();
 			m_thread_demux = nullptr;
+			m_demux_gate = nullptr;
 
+			_flush();
 			m_sync_progress = pos;
 		}
 	}
 
+	void Player::_flush()
+	{
+		// decoders the demuxer switched to, that their threads have not reached
+		AVCodecContext* codec_ctx;
+		while ((codec_ctx = m_playlist->PopDecoder(AVMEDIA_TYPE_AUDIO)) != nullptr)
+		{
+			avcodec_free_context(&m_p_codec_ctx_audio);
+			m_p_codec_ctx_audio = codec_ctx;
+			_open_resampler();
+		}
+		while ((codec_ctx = m_playlist->PopDecoder(AVMEDIA_TYPE_VIDEO)) != nullptr)
+		{
+			avcodec_free_context(&m_p_codec_ctx_video);
+			m_p_codec_ctx_video = codec_ctx;
+			m_video_width = codec_ctx->width;
+			m_video_height = codec_ctx->height;
+		}
+
+		if (m_a_idx >= 0)
+		{
+			m_queue_audio->Clear();
+			m_audio_ring->Clear();
+			avcodec_flush_buffers(m_p_codec_ctx_audio);
+		}
+		if (m_v_idx >= 0)
+		{
+			m_queue_video->Clear();
+			avcodec_flush_buffers(m_p_codec_ctx_video);
+		}
+	}
+
 
 	void Player::_start(uint64_t pos)
 	{
 		stop();
-		avformat_seek_file(m_p_fmt_ctx, -1, INT64_MIN, pos, INT64_MAX, 0);
+		_seek(pos);
 		m_sync_local_time = time_micro_sec();
 		m_sync_progress = pos;
+		_mark_start();
+		m_timeline_offset = 0;
+		m_timeline_end = 0;
+		m_segment_start = 0;
+		m_playlist->ClearSegments();
+
+		if (m_a_idx >= 0)
+		{
+			// audio is dropped when it cannot keep up with the clock; the demuxer reads this from its start
+			m_audio_muted = (m_free_run && m_v_idx >= 0) || (m_rate != 1.0 && !m_stretch_audio);
+			m_audio_ring->SetRate(m_rate);
+		}
 
 		m_demuxing = true;
+		m_demux_gate = (std::unique_ptr<PauseGate>)(new PauseGate(1));
 		m_thread_demux = (std::unique_ptr<std::thread>)(new std::thread(thread_demux, this));
 
 		if (m_v_idx >= 0)
@@ -531,8 +1497,9 @@ namespace LiveKit
 		if (m_a_idx >= 0)
 		{
 			m_audio_playing = true;
-			m_audio_eof = false;
-			m_audio_playback = (std::unique_ptr<AudioPlayback>)(new AudioPlayback(m_audio_device_id, this));
+			m_audio_eof = m_audio_muted;
+			if (!m_audio_muted)
+				m_audio_playback = (std::unique_ptr<AudioPlayback>)(new AudioPlayback(m_audio_device_id, this));
 		}		
 	}
 
@@ -550,43 +1517,19 @@ namespace LiveKit
 	{
 		if (m_thread_demux != nullptr)
 		{
-			_start(pos);
+			_seek_live(pos);
 		}
 		else
 		{
-			if (m_v_idx >= 0)
+			if (m_v_stream >= 0)
 			{
-				avformat_seek_file(m_p_fmt_ctx, -1, INT64_MIN, pos, INT64_MAX, 0);
-
-				bool frame_read = false;
-				while (av_read_frame(m_p_fmt_ctx, m_p_packet.get()) == 0)
-				{
-					if (m_p_packet->stream_index == m_v_idx)
-					{
-						int64_t t_frame = m_p_packet->dts * m_video_time_base_num * AV_TIME_BASE / m_video_time_base_den;
-						avcodec_send_packet(m_p_codec_ctx_video, m_p_packet.get());
-						avcodec_receive_frame(m_p_codec_ctx_video, m_p_frm_raw_video);
-						av_packet_unref(m_p_packet.get());
-						if (t_frame >= pos)
-						{
-							sws_scale(m_sws_ctx, (const uint8_t *const *)m_p_frm_raw_video->data, m_p_frm_raw_video->linesize,
-								0, m_p_codec_ctx_video->height, m_p_frm_bgr_video->data, m_p_frm_bgr_video->linesize);
-							frame_read = true;
-							break;
-						}						
-					}
-					else
-					{
-						av_packet_unref(m_p_packet.get());
-					}
-				}
-				
-				if (frame_read)
+				_seek(pos);
+				if (decode_to_frame(m_p_fmt_ctx, m_p_codec_ctx_video, m_v_stream, _video_pts(pos), m_p_packet.get(), m_p_frm_raw_video))
 				{
-					for (size_t i = 0; i < m_targets.size(); i++)
-					{
-						m_targets[i]->write_image(m_video_buffer.get());
-					}
+					std::vector<ImageRef> images;
+					_convert_video_frame(m_p_frm_raw_video, images);
+					_present_video_frame(images);
+					av_frame_unref(m_p_frm_raw_video);
 				}
 			}
 			m_sync_progress = pos;
@@ -594,14 +1537,234 @@ namespace LiveKit
 	}
 
 
+	void Player::append(const char* fn)
+	{
+		m_playlist->Append(fn);
+	}
+
+	void Player::clear_playlist()
+	{
+		m_playlist->Clear();
+	}
+
+	size_t Player::playlist_size() const
+	{
+		return m_playlist->Size();
+	}
+
+	void Player::set_rate(double rate, bool stretch_audio)
+	{
+		if (rate < s_min_rate) rate = s_min_rate;
+		if (rate > s_max_rate) rate = s_max_rate;
+		if (rate == m_rate && stretch_audio == m_stretch_audio) return;
+
+		if (m_thread_demux != nullptr)
+		{
+			stop();
+			m_rate = rate;
+			m_stretch_audio = stretch_audio;
+			_start(m_sync_progress);
+		}
+		else
+		{
+			m_rate = rate;
+			m_stretch_audio = stretch_audio;
+		}
+	}
+
+	void Player::set_free_run(bool enable)
+	{
+		if (enable == m_free_run) return;
+
+		if (m_thread_demux != nullptr)
+		{
+			stop();
+			m_free_run = enable;
+			_start(m_sync_progress);
+		}
+		else
+		{
+			m_free_run = enable;
+		}
+	}
+
+
+	void Player::_seek_live(uint64_t pos)
+	{
+		// every thread of the pipeline ends its run and waits, the audio device plays silence meanwhile
+		m_demuxing = false;
+		if (m_audio_playback != nullptr) m_audio_playback->Pause();
+		if (m_video_playback != nullptr) m_video_playback->Pause();
+		if (m_a_idx >= 0) m_queue_audio->Wake();
+		if (m_v_idx >= 0) m_queue_video->Wake();
+		m_demux_gate->WaitParked();
+		if (m_audio_playback != nullptr) m_audio_playback->WaitPaused();
+		if (m_video_playback != nullptr) m_video_playback->WaitPaused();
+
+		_flush();
+
+		// 'pos' is in the file being played. When the demuxer has read ahead into the next one, it goes
+		// back to the file it left; further back than that it is no longer open, and like stop() the
+		// player goes on with the demuxer's file from its start
+		int ahead = m_playlist->FilesAhead(_get_progress());
+		if (ahead > 0 && !(ahead == 1 && _rewind())) pos = 0;
+
+		_seek(pos);
+		_set_sync_point(time_micro_sec(), pos);
+		_mark_start();
+		m_timeline_offset = 0;
+		m_timeline_end = 0;
+		m_segment_start = 0;
+		m_playlist->ClearSegments();
+		m_audio_eof = m_audio_playback == nullptr;
+		m_video_eof = m_video_playback == nullptr;
+
+		if (m_video_playback != nullptr) m_video_playback->Resume();
+		if (m_audio_playback != nullptr) m_audio_playback->Resume();
+		m_demuxing = true;
+		m_demux_gate->Release();
+	}
+
+
+	bool Player::_rewind()
+	{
+		std::unique_ptr<Playlist::Item> left = m_playlist->TakeLeft();
+		if (left == nullptr) return false;
+
+		const AVCodecParameters* par_audio = left->a_idx >= 0 ? left->fmt_ctx->streams[left->a_idx]->codecpar : nullptr;
+		const AVCodecParameters* par_video = left->v_idx >= 0 ? left->fmt_ctx->streams[left->v_idx]->codecpar : nullptr;
+		m_playlist->Rewind(left->fn, m_fn, par_audio, par_video, m_loop);
+
+		// the running decoders were opened for the streams of the file being left now, or match them
+		if (par_audio != nullptr && m_a_stream >= 0 && !s_same_codec(par_audio, m_p_fmt_ctx->streams[m_a_stream]->codecpar))
+		{
+			avcodec_free_context(&m_p_codec_ctx_audio);
+			m_p_codec_ctx_audio = open_decoder(par_audio, m_decoder_options);
+			_open_resampler();
+		}
+		if (par_video != nullptr && m_v_stream >= 0 && !s_same_codec(par_video, m_p_fmt_ctx->streams[m_v_stream]->codecpar))
+		{
+			avcodec_free_context(&m_p_codec_ctx_video);
+			m_p_codec_ctx_video = open_decoder(par_video, m_decoder_options);
+			m_video_width = m_p_codec_ctx_video->width;
+			m_video_height = m_p_codec_ctx_video->height;
+		}
+
+		// the file the demuxer was in is closed along with 'left'
+		std::swap(m_p_fmt_ctx, left->fmt_ctx);
+		std::swap(m_video_index, left->index);
+		m_fn = left->fn;
+		m_a_stream = left->a_idx;
+		m_v_stream = left->v_idx;
+		m_duration = m_p_fmt_ctx->duration;
+		m_fresh_input = false;
+		return true;
+	}
+
+	void Player::_mark_start()
+	{
+		m_start_time = time_micro_sec();
+		m_first_video_frame = 0;
+		m_first_audio = 0;
+		m_video_started = false;
+
+		m_live_edge_offset = INT64_MAX;
+		m_live_edge_current = INT64_MAX;
+		m_live_edge_previous = INT64_MAX;
+		m_live_window_start = 0;
+		m_live_drop_until = 0;
+	}
+
+	void Player::get_startup_timings(StartupTimings* timings) const
+	{
+		*timings = m_startup_timings;
+		timings->first_video_frame = m_first_video_frame;
+		timings->first_audio = m_first_audio;
+	}
+
+	void Player::get_live_stats(LiveStats* stats) const
+	{
+		stats->latency = 0;
+		int64_t edge_offset = m_live_edge_offset;
+		if (m_thread_demux != nullptr && edge_offset != INT64_MAX)
+		{
+			uint64_t now = time_micro_sec();
+			int64_t latency = (int64_t)now - edge_offset - (int64_t)_get_progress(now);
+			if (latency > 0) stats->latency = (uint64_t)latency;
+		}
+		stats->target_latency = m_target_latency;
+		stats->catch_ups = m_live_catch_ups;
+		stats->dropped_duration = m_live_dropped_duration;
+	}
+
+	void Player::_follow_live_edge(int64_t time)
+	{
+		if (time == AV_NOPTS_VALUE) return;
+
+		// the least delayed packet marks the live edge. Windows older than the last two are forgotten,
+		// so that the edge follows a drift between the sender's clock and ours
+		uint64_t now = time_micro_sec();
+		if (now - m_live_window_start >= s_live_edge_window)
+		{
+			m_live_edge_previous = m_live_edge_current;
+			m_live_edge_current = INT64_MAX;
+			m_live_window_start = now;
+		}
+		int64_t offset = (int64_t)now - time;
+		if (offset < m_live_edge_current) m_live_edge_current = offset;
+		int64_t edge_offset = min(m_live_edge_current, m_live_edge_previous);
+		m_live_edge_offset = edge_offset;
+
+		int64_t target_latency = (int64_t)m_target_latency;
+		int64_t latency = (int64_t)now - edge_offset - (int64_t)_get_progress(now);
+		if (latency <= target_latency + s_live_tolerance) return;
+
+		// catch up: the clock jumps ahead, the decoders and the audio device drop what is behind it
+		int64_t progress = (int64_t)now - edge_offset - target_latency;
+		m_live_drop_until = progress;
+		_set_sync_point(now, (uint64_t)progress);
+		m_live_catch_ups++;
+		m_live_dropped_duration += (uint64_t)(latency - target_latency);
+	}
+
+
+	int64_t Player::_video_pts(uint64_t pos) const
+	{
+		AVRational micro_sec = { 1, AV_TIME_BASE };
+		return av_rescale_q((int64_t)pos, micro_sec, m_p_fmt_ctx->streams[m_v_stream]->time_base);
+	}
+
+	void Player::_seek(uint64_t pos)
+	{
+		// nothing has been read since opening, the demuxer is at the start already
+		bool fresh = m_fresh_input;
+		m_fresh_input = false;
+		if (fresh && pos == 0) return;
+
+		if (m_v_stream >= 0 && m_video_index == nullptr && !m_live)
+			m_video_index = (std::unique_ptr<KeyframeIndex>)(new KeyframeIndex(m_fn.c_str(), m_v_stream));
+
+		if (m_video_index != nullptr)
+		{
+			// video decides where to start, so that its first frame can be exact
+			m_video_index->seek(m_p_fmt_ctx, m_p_codec_ctx_video, _video_pts(pos));
+		}
+		else
+		{
+			avformat_seek_file(m_p_fmt_ctx, -1, INT64_MIN, pos, INT64_MAX, 0);
+		}
+	}
+
+
 	void Player::set_audio_device(int audio_device_id)
 	{
 		if (audio_device_id != m_audio_device_id)
 		{
 			m_audio_device_id = audio_device_id;
-			if (m_a_idx >= 0 && m_thread_demux != nullptr)
+			if (m_a_idx >= 0 && m_thread_demux != nullptr && !m_audio_muted)
 			{
 				m_audio_playing = false;
+				m_queue_audio->Wake();
 				m_audio_playback = nullptr;
 				m_audio_playing = true;
 				m_audio_eof = false;
@@ -611,6 +1774,28 @@ namespace LiveKit
 	}
 
 
+	void Player::_open_resampler()
+	{
+		// whatever the decoder's rate, the output stays at the device's
+		swr_free(&m_swr_ctx);
+		int64_t layout_in = av_get_default_channel_layout(m_p_codec_ctx_audio->channels);
+		m_swr_ctx = swr_alloc_set_opts(nullptr, AV_CH_LAYOUT_STEREO, AV_SAMPLE_FMT_S16, m_audio_sample_rate,
+			layout_in, m_p_codec_ctx_audio->sample_fmt, m_p_codec_ctx_audio->sample_rate, 0, nullptr);
+		swr_init(m_swr_ctx);
+	}
+
+
+	void Player::_convert_video_frame(const AVFrame* frame, std::vector<ImageRef>& images)
+	{
+		m_video_outputs->convert(frame, m_targets, images);
+	}
+
+	void Player::_present_video_frame(const std::vector<ImageRef>& images)
+	{
+		TargetConverter::s_present(m_targets, images);
+	}
+
+
 	void Player::_set_sync_point(uint64_t local_time, uint64_t progress)
 	{
 		EnterCriticalSection(&m_cs_sync);
@@ -628,23 +1813,117 @@ namespace LiveKit
 	}
 
 
+	int64_t Player::_retime(AVPacket* packet, int num, int den)
+	{
+		AVRational micro_sec = { 1, AV_TIME_BASE };
+		AVRational time_base = { num, den };
+		av_packet_rescale_ts(packet, m_p_fmt_ctx->streams[packet->stream_index]->time_base, time_base);
+
+		int64_t offset = av_rescale_q(m_timeline_offset, micro_sec, time_base);
+		if (packet->pts != AV_NOPTS_VALUE) packet->pts += offset;
+		if (packet->dts != AV_NOPTS_VALUE) packet->dts += offset;
+
+		int64_t t = packet->pts != AV_NOPTS_VALUE ? packet->pts : packet->dts;
+		if (t != AV_NOPTS_VALUE)
+		{
+			int64_t end = av_rescale_q(t + packet->duration, time_base, micro_sec);
+			if (end > m_timeline_end) m_timeline_end = end;
+			return av_rescale_q(t, time_base, micro_sec);
+		}
+		return AV_NOPTS_VALUE;
+	}
+
+	bool Player::_next_file()
+	{
+		std::unique_ptr<Playlist::Item> item = m_playlist->TakeNext(m_loop);
+		bool new_file = item != nullptr;
+		if (item == nullptr)
+		{
+			// a file that yields nothing is not looped forever
+			if (!m_loop || m_timeline_end <= m_segment_start) return false;
+
+			// the same file again, its decoders carry on
+			int64_t start = m_p_fmt_ctx->start_time != AV_NOPTS_VALUE ? m_p_fmt_ctx->start_time : 0;
+			if (avformat_seek_file(m_p_fmt_ctx, -1, INT64_MIN, start, start, 0) < 0) return false;
+		}
+		else
+		{
+			// without a decoder thread to take them (muted audio), stop() installs the new decoders
+			AVPacket* marker = av_packet_alloc();
+			if (item->codec_ctx_audio != nullptr)
+			{
+				m_playlist->PushDecoder(AVMEDIA_TYPE_AUDIO, item->codec_ctx_audio);
+				item->codec_ctx_audio = nullptr;
+				marker->stream_index = s_decoder_switch;
+				if (!m_audio_muted) m_queue_audio->Push(marker, m_demuxing);
+			}
+			if (item->codec_ctx_video != nullptr)
+			{
+				m_playlist->PushDecoder(AVMEDIA_TYPE_VIDEO, item->codec_ctx_video);
+				item->codec_ctx_video = nullptr;
+				marker->stream_index = s_decoder_switch;
+				m_queue_video->Push(marker, m_demuxing);
+			}
+			av_packet_free(&marker);
+
+			// the finished file may still be playing, it is kept in case set_position() goes back into it
+			std::swap(m_p_fmt_ctx, item->fmt_ctx);
+			std::swap(m_video_index, item->index);
+			std::swap(m_fn, item->fn);
+			std::swap(m_a_stream, item->a_idx);
+			std::swap(m_v_stream, item->v_idx);
+			m_duration = m_p_fmt_ctx->duration;
+			m_playlist->SetLeft(std::move(item));
+		}
+
+		// the next file starts where this one ended
+		int64_t start = m_p_fmt_ctx->start_time != AV_NOPTS_VALUE ? m_p_fmt_ctx->start_time : 0;
+		m_timeline_offset = m_timeline_end - start;
+		m_segment_start = m_timeline_end;
+		m_playlist->AddSegment((uint64_t)m_timeline_end, m_timeline_offset, new_file);
+		return true;
+	}
+
 	void Player::thread_demux(Player* self)
 	{
-		while (self->m_demuxing && av_read_frame(self->m_p_fmt_ctx, self->m_p_packet.get()) == 0)
+		do
 		{
-			if (self->m_p_packet->stream_index == self->m_a_idx)
+			_demux(self);
+		} while (self->m_demux_gate->Park());
+	}
+
+	void Player::_demux(Player* self)
+	{
+		AVPacket* packet = self->m_p_packet.get();
+		while (self->m_demuxing)
+		{
+			if (av_read_frame(self->m_p_fmt_ctx, packet) != 0)
+			{
+				if (!self->_next_file()) break;
+				continue;
+			}
+
+			if (packet->stream_index == self->m_a_stream && !self->m_audio_muted)
 			{
-				self->m_queue_audio->Push(*self->m_p_packet);
+				int64_t time = self->_retime(packet, self->m_audio_time_base_num, self->m_audio_time_base_den);
+				if (self->m_live) self->_follow_live_edge(time);
+				if (!self->m_queue_audio->Push(packet, self->m_demuxing))
+					av_packet_unref(packet);
 			}
-			else if (self->m_p_packet->stream_index == self->m_v_idx)
+			else if (packet->stream_index == self->m_v_stream)
 			{
-				self->m_queue_video->Push(*self->m_p_packet);
+				int64_t time = self->_retime(packet, self->m_video_time_base_num, self->m_video_time_base_den);
+				if (self->m_live) self->_follow_live_edge(time);
+				if (!self->m_queue_video->Push(packet, self->m_demuxing))
+					av_packet_unref(packet);
 			}
 			else
 			{
-				av_packet_unref(self->m_p_packet.get());
+				av_packet_unref(packet);
 			}
 		}
+		if (self->m_a_idx >= 0) self->m_queue_audio->SetEOF();
+		if (self->m_v_idx >= 0) self->m_queue_video->SetEOF();
 		self->m_demuxing = false;
 	}
 
@@ -1,6 +1,9 @@
 #pragma once
+#include "DecoderOptions.h"
+#include <atomic>
 #include <cstdint>
 #include <memory>
+#include <string>
 #include <Windows.h>
 #include <vector>
 
@@ -13,7 +16,6 @@ struct AVFormatContext;
 struct AVCodecContext;
 struct AVFrame;
 struct SwrContext;
-struct SwsContext;
 struct AVPacket;
 
 namespace LiveKit
@@ -32,16 +34,71 @@ namespace LiveKit
 		int audio_bitrate = 0;
 	};
 
-	void get_media_info(const char* fn, MediaInfo* info);
+	void get_media_info(const char* fn, MediaInfo* info, const DecoderOptions& decoder_options = DecoderOptions());
+
+	struct AudioPlaybackStats
+	{
+		uint64_t underruns = 0; // device callbacks that found too little decoded audio
+		uint64_t underrun_samples = 0; // silence played in their place
+		uint64_t buffered_samples = 0; // decoded audio waiting for the device
+		uint64_t capacity_samples = 0;
+	};
+
+	// frames given up on to keep up with the clock
+	struct VideoPlaybackStats
+	{
+		uint64_t shed_decode = 0; // non-reference frames the decoder skipped, estimated
+		uint64_t shed_convert = 0; // decoded, but not converted since a newer frame was due
+		uint64_t shed_present = 0; // converted, but not shown since a newer frame was due
+		int shed_level = 0; // 0: full quality, 1: non-reference frames skipped, 2: also deblocking of reference frames
+		uint64_t shedding_time = 0; // microseconds spent at a level above 0
+	};
+
+	// where the time to first output went, microseconds. The first_* times count from the last
+	// start() or set_position(), 0 until that output happens
+	struct StartupTimings
+	{
+		uint64_t open_input = 0;
+		uint64_t find_stream_info = 0;
+		uint64_t open_audio_decoder = 0;
+		uint64_t open_video_decoder = 0;
+		uint64_t open_decoders = 0; // wall time of both, less than their sum when opened in parallel
+		uint64_t first_video_frame = 0;
+		uint64_t first_audio = 0;
+	};
+
+	// live mode, microseconds. The latency is how far playback is behind the least delayed packet
+	// received lately, the delay before that packet reached us cannot be seen without the sender's clock
+	struct LiveStats
+	{
+		uint64_t latency = 0;
+		uint64_t target_latency = 0;
+		uint64_t catch_ups = 0; // times playback jumped ahead to get back within the target
+		uint64_t dropped_duration = 0; // media skipped by those jumps
+	};
 
 	class AudioBuffer;
+	enum class PixelFormat;
 	class Image;
+	class TargetConverter;
 	class VideoTarget;
+	class FramePacer;
+	class PacketQueue;
+	class KeyframeIndex;
+	class PcmRing;
+	class PauseGate;
+	struct PacketQueueStats;
+	struct PacingStats;
 
 	class Player
 	{
 	public:
-		Player(const char* fn, bool play_audio = true, bool play_video = true, int audio_device_id = 0);
+		// 'fast_start' probes less of the input, opens the decoders in parallel and shows video from the
+		// first keyframe while audio catches up, instead of waiting for both.
+		// 'live' is for network inputs: no input buffering, low-delay decoding, and playback is kept
+		// within the target latency of the newest packets by skipping ahead when it falls behind
+		Player(const char* fn, bool play_audio = true, bool play_video = true, int audio_device_id = 0, bool fast_start = false, bool live = false,
+			const DecoderOptions& decoder_options = DecoderOptions());
 		~Player();
 
 		void AddTarget(VideoTarget* target)
@@ -62,13 +119,63 @@ namespace LiveKit
 		void set_position(uint64_t pos);
 		void set_audio_device(int audio_device_id);
 
+		// how punctually video frames have been presented
+		void get_pacing_stats(PacingStats* stats) const;
+
+		// occupancy of the demux queues, a queue that keeps running dry counts underruns
+		void get_queue_stats(PacketQueueStats* audio, PacketQueueStats* video) const;
+
+		// how well audio decoding keeps ahead of the device
+		void get_audio_stats(AudioPlaybackStats* stats) const;
+
+		// how much video decoding has been cut back while behind the clock
+		void get_video_stats(VideoPlaybackStats* stats) const;
+
+		// speed of the playback clock, from 0.25 to 16. Audio is time-stretched to keep its pitch,
+		// or muted when 'stretch_audio' is false
+		void set_rate(double rate, bool stretch_audio = true);
+		double get_rate() const { return m_rate; }
+
+		// delivers every video frame as soon as the targets accept it, ignoring the clock.
+		// Audio is muted, the position follows the frames delivered
+		void set_free_run(bool enable);
+		bool is_free_run() const { return m_free_run; }
+
+		// files to play after this one, each opened ahead of its turn so that playback moves on without a gap.
+		// The position and duration are those of the file being played
+		void append(const char* fn);
+		void clear_playlist();
+		size_t playlist_size() const;
+
+		// starts over at the end: the same file when the playlist is empty, otherwise the played files
+		// go back to the end of the playlist
+		void set_loop(bool loop) { m_loop = loop; }
+		bool is_looping() const { return m_loop; }
+
+		void get_startup_timings(StartupTimings* timings) const;
+
+		// live mode only, microseconds
+		void set_target_latency(uint64_t latency) { m_target_latency = latency; }
+		uint64_t get_target_latency() const { return m_target_latency; }
+		void get_live_stats(LiveStats* stats) const;
+
 
 	private:
-		class PacketQueue;
 		class AudioPlayback;
 		class VideoPlayback;
+		class Playlist;
 
 		void _start(uint64_t pos);
+		void _seek_live(uint64_t pos);
+		bool _rewind();
+		void _flush();
+		uint64_t _get_progress(uint64_t now = 0) const;
+		void _seek(uint64_t pos);
+		int64_t _video_pts(uint64_t pos) const;
+		bool _next_file();
+		int64_t _retime(AVPacket* packet, int num, int den);
+		void _follow_live_edge(int64_t time);
+		void _mark_start();
 
 		std::unique_ptr<PacketQueue> m_queue_audio;
 		std::unique_ptr<PacketQueue> m_queue_video;
@@ -77,30 +184,64 @@ namespace LiveKit
 
 		int m_a_idx = -1;
 		int m_v_idx = -1;
+		int m_a_stream = -1; // of the file being demuxed, m_a_idx/m_v_idx are those of the first file
+		int m_v_stream = -1;
 
 		int m_audio_time_base_num, m_audio_time_base_den;
 		int m_video_time_base_num, m_video_time_base_den;
-		int m_video_width, m_video_height;
+		// the decoder updates them when the size changes mid-stream
+		std::atomic<int> m_video_width{ 0 };
+		std::atomic<int> m_video_height{ 0 };
 		uint64_t m_duration;
 
 		AVCodecContext* m_p_codec_ctx_audio;
 		AVFrame *m_p_frm_raw_audio;
 		AVFrame *m_p_frm_s16_audio;
 		std::unique_ptr<AudioBuffer> m_audio_buffer;
-		SwrContext *m_swr_ctx;
+		SwrContext *m_swr_ctx = nullptr;
+		int m_audio_sample_rate = 0;
+		void _open_resampler();
+		std::unique_ptr<PcmRing> m_audio_ring;
+		// counted by the audio device thread, read by get_audio_stats()
+		std::atomic<uint64_t> m_audio_underruns{ 0 };
+		std::atomic<uint64_t> m_audio_underrun_samples{ 0 };
 
 		AVCodecContext* m_p_codec_ctx_video;
 		AVFrame *m_p_frm_raw_video;
-		AVFrame *m_p_frm_bgr_video;
-		std::unique_ptr<Image> m_video_buffer;
-		SwsContext* m_sws_ctx;
+		PixelFormat m_video_format;
+		std::unique_ptr<TargetConverter> m_video_outputs;
+		std::unique_ptr<FramePacer> m_video_pacer;
+		std::unique_ptr<KeyframeIndex> m_video_index;
+		// counted by the decode, convert and present threads, read by get_video_stats()
+		std::atomic<int> m_video_shed_level{ 0 };
+		std::atomic<uint64_t> m_video_shed_start{ 0 };
+		std::atomic<uint64_t> m_video_shedding_time{ 0 };
+		std::atomic<uint64_t> m_video_shed_sent{ 0 }; // packets decoded while shedding
+		std::atomic<uint64_t> m_video_shed_received{ 0 }; // frames received while shedding
+		std::atomic<uint64_t> m_video_shed_convert{ 0 };
+		std::atomic<uint64_t> m_video_shed_present{ 0 };
+		void _convert_video_frame(const AVFrame* frame, std::vector<std::shared_ptr<const Image>>& images);
+		void _present_video_frame(const std::vector<std::shared_ptr<const Image>>& images);
 
 		std::unique_ptr<AVPacket> m_p_packet;
-		bool m_demuxing = false;
-		bool m_audio_playing = false;
-		bool m_video_playing = false;
-		bool m_audio_eof = true;
-		bool m_video_eof = true;
+		// read by the blocking queue calls of the pipeline threads
+		std::atomic<bool> m_demuxing{ false };
+		std::atomic<bool> m_audio_playing{ false };
+		std::atomic<bool> m_video_playing{ false };
+		// set by the playback threads at the end, the fast-start audio stops waiting for video at its end
+		std::atomic<bool> m_audio_eof{ true };
+		std::atomic<bool> m_video_eof{ true };
+
+		double m_rate = 1.0;
+		bool m_stretch_audio = true;
+		bool m_free_run = false;
+		bool m_audio_muted = false;
+
+		std::unique_ptr<Playlist> m_playlist;
+		std::atomic<bool> m_loop{ false }; // set by the API, read by the demuxer
+		int64_t m_timeline_offset = 0; // added to the timestamps of the file being demuxed, microseconds
+		int64_t m_timeline_end = 0;
+		int64_t m_segment_start = 0;
 
 		uint64_t m_sync_local_time;
 		uint64_t m_sync_progress;
@@ -110,8 +251,31 @@ namespace LiveKit
 
 		int m_audio_device_id;
 
+		std::string m_fn;
+		bool m_fast_start;
+		bool m_fresh_input = true; // nothing read since opening
+		std::atomic<bool> m_video_started{ false }; // the fast-start audio waits for the present thread to set it
+		uint64_t m_start_time = 0;
+		StartupTimings m_startup_timings; // of opening, the first frame and audio are timed by the playback threads
+		std::atomic<uint64_t> m_first_video_frame{ 0 };
+		std::atomic<uint64_t> m_first_audio{ 0 };
+
+		bool m_live;
+		DecoderOptions m_decoder_options; // live mode adds low delay
+		// the demuxer follows the live edge; the decoders read where it drops to, the API the rest
+		std::atomic<uint64_t> m_target_latency{ 500000 };
+		std::atomic<int64_t> m_live_edge_offset{ INT64_MAX }; // local time minus stream time at the live edge
+		int64_t m_live_edge_current = INT64_MAX;
+		int64_t m_live_edge_previous = INT64_MAX;
+		uint64_t m_live_window_start = 0;
+		std::atomic<int64_t> m_live_drop_until{ 0 }; // what is behind this stream time is not played
+		std::atomic<uint64_t> m_live_catch_ups{ 0 };
+		std::atomic<uint64_t> m_live_dropped_duration{ 0 };
+
 		static void thread_demux(Player* self);
+		static void _demux(Player* self);
 		std::unique_ptr<std::thread> m_thread_demux;
+		std::unique_ptr<PauseGate> m_demux_gate;
 
 		std::unique_ptr<AudioPlayback> m_audio_playback;
 		std::unique_ptr<VideoPlayback> m_video_playback;
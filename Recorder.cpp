@@ -1,8 +1,12 @@
 #include "Recorder.h"
 #include "Image.h"
+#include "ImageConverter.h"
 #include "VideoPort.h"
 #include "AudioIO.h"
 #include "BufferQueue.h"
+#include "ImageCopy.h"
+#include "FramePacer.h"
+#include "SliceScaler.h"
 #include "Utils.h"
 
 extern "C"
@@ -78,8 +82,9 @@ namespace LiveKit
 		AVFrame *frame = nullptr;
 		AVFrame *tmp_frame = nullptr;
 		unsigned char *tmp_buffer = nullptr;
+		int tmp_stride = 0;
 
-		struct SwsContext *sws_ctx = nullptr;
+		SliceScaler *scaler = nullptr;
 		struct SwrContext *swr_ctx = nullptr;
 	};
 
@@ -141,7 +146,7 @@ namespace LiveKit
 		/* allocate and init a re-usable frame */
 		ost->frame = alloc_picture(c->pix_fmt, c->width, c->height);
 		avcodec_parameters_from_context(ost->st->codecpar, c);
-		ost->sws_ctx = sws_getContext(c->width, c->height, AV_PIX_FMT_BGR24, c->width, c->height, c->pix_fmt, SWS_BILINEAR, nullptr, nullptr, nullptr);
+		ost->scaler = new SliceScaler(SWS_BILINEAR);
 	}
 
 	inline AVFrame *alloc_audio_frame(enum AVSampleFormat sample_fmt, uint64_t channel_layout, int sample_rate, int nb_samples)
@@ -188,13 +193,14 @@ namespace LiveKit
 		avcodec_free_context(&ost->enc);
 		av_frame_free(&ost->frame);
 		av_frame_free(&ost->tmp_frame);
-		if (ost->tmp_buffer != nullptr) free(ost->tmp_buffer);
-		sws_freeContext(ost->sws_ctx);
+		av_free(ost->tmp_buffer);
+		delete ost->scaler;
 		swr_free(&ost->swr_ctx);
 	}
 
 	Recorder::Recorder(const char* filename, bool mp4, int video_width, int video_height, bool record_audio, int audio_device_id)
 		: m_video_width(video_width), m_video_height(video_height), m_record_audio(record_audio), m_audio_device_id(audio_device_id)
+		, m_converter(new ImageConverter), m_pacer(new FramePacer)
 	{
 		AVOutputFormat *output_format = av_guess_format(mp4 ? "mp4" : "flv", nullptr, filename);
 		avformat_alloc_output_context2(&m_oc, output_format, nullptr, filename);
@@ -230,6 +236,20 @@ namespace LiveKit
 		if (!(m_fmt->flags & AVFMT_NOFILE))
 			avio_closep(&m_oc->pb);
 		avformat_free_context(m_oc);
+		if (m_source != nullptr)
+			m_source->cancel_format_request(this);
+	}
+
+	void Recorder::SetSource(const VideoSource* source)
+	{
+		if (m_source != nullptr)
+			m_source->cancel_format_request(this);
+		m_source = source;
+		m_last_timestamp = (uint64_t)(-1);
+
+		// frames are recorded at the source's size, another reader of a shared port must not shrink them
+		if (m_source != nullptr)
+			m_source->request_format(VideoFormatRequest(), this);
 	}
 
 	void Recorder::start()
@@ -240,6 +260,7 @@ namespace LiveKit
 				m_audio_recorder = (std::unique_ptr<AudioRecorder>)(new AudioRecorder(m_audio_device_id));
 
 			m_recording = true;
+			m_pacer->reset_stats();
 			m_start_time = time_micro_sec();
 			m_frame_count = 0;
 			m_thread_write = (std::unique_ptr<std::thread>)(new std::thread(thread_write, this));
@@ -326,28 +347,67 @@ namespace LiveKit
 
 	}
 
+	void Recorder::get_pacing_stats(PacingStats* stats) const
+	{
+		*stats = m_pacer->get_stats();
+	}
+
 	void Recorder::update_video()
 	{
 		AVCodecContext *c = m_video_st->enc;
 		if (m_video_st->tmp_buffer == nullptr)
-			m_video_st->tmp_buffer = (uint8_t*)malloc((size_t)m_video_width* m_video_height * 3);
+		{
+			// 4 bytes per pixel with aligned rows is the fast input path of swscale
+			m_video_st->tmp_stride = Image::s_default_stride(m_video_width, PixelFormat::BGRX);
+			m_video_st->tmp_buffer = (uint8_t*)av_malloc((size_t)m_video_st->tmp_stride * m_video_height);
+		}
+
+		av_frame_make_writable(m_video_st->frame);
+
+		// the encoder frame still holds the last picture, re-encode it if the source has nothing new
+		if (m_source != nullptr && m_last_timestamp != (uint64_t)(-1) && m_source->peek_timestamp() == m_last_timestamp)
+		{
+			m_video_st->frame->pts = m_video_st->next_pts++;
+			write_frame(m_oc, m_video_st->enc, m_video_st->st, m_video_st->frame);
+			return;
+		}
 
-		memset(m_video_st->tmp_buffer, 0, (size_t)m_video_width*m_video_height * 3);
+		bool copied = false;
+
+		memset(m_video_st->tmp_buffer, 0, (size_t)m_video_st->tmp_stride * m_video_height);
 		if (m_source != nullptr)
 		{
 			uint64_t timestamp;
-			const Image* img_in = m_source->read_image(&timestamp);
+			const Image* img_in = m_source->lock_image(&timestamp);
+			m_last_timestamp = timestamp;
 			if (timestamp != (uint64_t)(-1))
 			{
-				copy_centered(img_in->data(), img_in->width(), img_in->height(), img_in->has_alpha() ? 4 : 3,
-					m_video_st->tmp_buffer, m_video_width, m_video_height, 3, img_in->is_flipped());
+				if (img_in->format() == PixelFormat::I420 && c->pix_fmt == AV_PIX_FMT_YUV420P && !img_in->is_flipped()
+					&& img_in->width() == c->width && img_in->height() == c->height)
+				{
+					// already in the encoder's input format
+					const uint8_t* src_data[4] = { img_in->data(0), img_in->data(1), img_in->data(2), nullptr };
+					int src_linesize[4] = { img_in->stride(0), img_in->stride(1), img_in->stride(2), 0 };
+					av_image_copy(m_video_st->frame->data, m_video_st->frame->linesize, src_data, src_linesize, AV_PIX_FMT_YUV420P, c->width, c->height);
+					copied = true;
+				}
+				else
+				{
+					const Image* packed = m_converter->to_packed(img_in);
+					copy_centered(packed->data(), packed->width(), packed->height(), packed->pixel_size(), packed->stride(),
+						m_video_st->tmp_buffer, m_video_width, m_video_height, 4, m_video_st->tmp_stride, packed->is_flipped());
+				}
 			}
+			m_source->unlock_image(img_in);
 		}
 
-		av_frame_make_writable(m_video_st->frame);
-		const unsigned char* p_data = m_video_st->tmp_buffer;
-		int stride = c->width * 3;
-		sws_scale(m_video_st->sws_ctx, &p_data, &stride, 0, c->height, m_video_st->frame->data, m_video_st->frame->linesize);
+		if (!copied)
+		{
+			const unsigned char* p_data = m_video_st->tmp_buffer;
+			int stride = m_video_st->tmp_stride;
+			m_video_st->scaler->scale(&p_data, &stride, c->width, c->height, AV_PIX_FMT_BGR0,
+				m_video_st->frame->data, m_video_st->frame->linesize, c->width, c->height, c->pix_fmt);
+		}
 
 		m_video_st->frame->pts = m_video_st->next_pts++;
 		write_frame(m_oc, m_video_st->enc, m_video_st->st, m_video_st->frame);
@@ -379,11 +439,7 @@ namespace LiveKit
 			{
 				self->m_frame_count++;
 				uint64_t target = self->m_start_time + self->m_frame_count * AV_TIME_BASE / fps;
-				uint64_t now = time_micro_sec();
-				int64_t delta = target - now;
-				if (delta > 0)
-					std::this_thread::sleep_for(std::chrono::microseconds(delta));
-
+				self->m_pacer->wait_until(target);
 				self->update_video();
 			}
 
@@ -14,7 +14,10 @@ namespace LiveKit
 {
 	class AudioBuffer;
 	class VideoSource;
+	class ImageConverter;
+	class FramePacer;
 	struct OutputStream;
+	struct PacingStats;
 
 	class Recorder
 	{
@@ -22,14 +25,14 @@ namespace LiveKit
 		Recorder(const char* filename, bool mp4, int video_width, int video_height, bool record_audio = false, int audio_device_id = 0);
 		~Recorder();
 
-		void SetSource(const VideoSource* source)
-		{
-			m_source = source;
-		}
+		void SetSource(const VideoSource* source);
 
 		void start();
 		void stop();
 
+		// deadline statistics of the video frames since start()
+		void get_pacing_stats(PacingStats* stats) const;
+
 	private:
 		class AudioRecorder;
 
@@ -44,6 +47,8 @@ namespace LiveKit
 
 		std::unique_ptr<AudioRecorder> m_audio_recorder;
 		const VideoSource* m_source = nullptr;
+		uint64_t m_last_timestamp = (uint64_t)(-1);
+		std::unique_ptr<ImageConverter> m_converter;
 
 		AudioBuffer* m_buf_in = nullptr;
 		int m_in_pos = 0;
@@ -51,6 +56,7 @@ namespace LiveKit
 		bool m_recording = false;
 		uint64_t m_start_time;
 		size_t m_frame_count;
+		std::unique_ptr<FramePacer> m_pacer;
 		void update_video();
 		void update_audio();
 		void update_av();
@@ -1,39 +1,322 @@
 #include "VideoPort.h"
 #include "Image.h"
 #include "Utils.h"
+#include <thread>
 
 namespace LiveKit
 {
-	VideoPort::VideoPort()
+	uint64_t VideoSource::peek_timestamp() const
 	{
-		memset(m_timestamps, 0xFF, sizeof(uint64_t) * 3);
+		uint64_t timestamp;
+		read_image(&timestamp);
+		return timestamp;
+	}
+
+	bool VideoSource::wait_image(uint64_t last_timestamp, int timeout_ms) const
+	{
+		// sources without a notification mechanism are polled
+		uint64_t deadline = time_micro_sec() + (uint64_t)timeout_ms * 1000;
+		while (true)
+		{
+			uint64_t timestamp = peek_timestamp();
+			if (timestamp != (uint64_t)(-1) && timestamp != last_timestamp) return true;
+			if (timeout_ms >= 0 && time_micro_sec() >= deadline) return false;
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+
+	void VideoFormatRequests::set(const void* reader, const VideoFormatRequest& request)
+	{
+		for (size_t i = 0; i < m_requests.size(); i++)
+		{
+			if (m_requests[i].first == reader)
+			{
+				m_requests[i].second = request;
+				return;
+			}
+		}
+		m_requests.push_back(std::make_pair(reader, request));
+	}
+
+	void VideoFormatRequests::remove(const void* reader)
+	{
+		for (size_t i = 0; i < m_requests.size(); i++)
+		{
+			if (m_requests[i].first == reader)
+			{
+				m_requests.erase(m_requests.begin() + i);
+				return;
+			}
+		}
+	}
+
+	bool VideoFormatRequests::get(VideoFormatRequest* request) const
+	{
+		*request = VideoFormatRequest();
+		if (m_requests.empty()) return false;
+
+		// a size of 0 asks for the source's own size, which is at least as large as any other request
+		bool full_size = false;
+		request->packed = true;
+		for (size_t i = 0; i < m_requests.size(); i++)
+		{
+			const VideoFormatRequest& r = m_requests[i].second;
+			if (r.width <= 0 || r.height <= 0) full_size = true;
+			if (r.width > request->width) request->width = r.width;
+			if (r.height > request->height) request->height = r.height;
+			if (!r.packed) request->packed = false;
+		}
+		if (full_size)
+		{
+			request->width = 0;
+			request->height = 0;
+		}
+		return true;
+	}
+
+	VideoPort::VideoPort(int depth, Mode mode, int write_timeout_ms)
+		: m_mode(mode), m_depth(depth < 2 ? 2 : depth), m_write_timeout_ms(write_timeout_ms)
+	{
+		// Latest mode keeps the newest frame plus one being written, Lossless mode the
+		// unread frames plus the one last handed out
+		m_slots.resize(m_mode == Mode::Latest ? m_depth : m_depth + 1);
+		m_last_video_buf = (int)m_slots.size() - 1;
 	}
 
 	VideoPort::~VideoPort()
 	{
 
 	}
-	
+
+	VideoPortStats VideoPort::get_stats() const
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		return m_stats;
+	}
+
+	void VideoPort::reset_stats()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_stats = VideoPortStats();
+	}
+
+	int VideoPort::_begin_write(ImageRef& old_image, std::shared_ptr<Image>& buffer)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		if (m_mode == Mode::Lossless)
+		{
+			auto has_space = [this]() { return m_pending < m_depth; };
+			if (m_write_timeout_ms < 0)
+			{
+				m_cond_space.wait(lock, has_space);
+			}
+			else if (!m_cond_space.wait_for(lock, std::chrono::milliseconds(m_write_timeout_ms), has_space))
+			{
+				m_stats.frames_dropped++;
+				return -1;
+			}
+			m_pending++;
+		}
+
+		int this_buf = -1;
+		int num_bufs = (int)m_slots.size();
+		for (int i = 1; i < num_bufs; i++)
+		{
+			int j = (m_last_video_buf + i) % num_bufs;
+			const Slot& slot = m_slots[j];
+			if (slot.pin_count == 0 && !slot.writing && (m_mode == Mode::Latest || !_is_pending(slot)))
+			{
+				this_buf = j;
+				break;
+			}
+		}
+		if (this_buf < 0)
+		{
+			// every other slot is pinned by a reader, grow instead of overwriting
+			this_buf = num_bufs;
+			m_slots.resize(num_bufs + 1);
+		}
+		Slot& slot = m_slots[this_buf];
+		slot.writing = true;
+		old_image = std::move(slot.image);
+		buffer = std::move(slot.buffer);
+		return this_buf;
+	}
+
+	void VideoPort::_end_write(int this_buf, const ImageRef& image, const std::shared_ptr<Image>& buffer)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			Slot& slot = m_slots[this_buf];
+			slot.image = image;
+			slot.buffer = buffer;
+
+			// strictly increasing, so that consumers comparing timestamps never miss a frame
+			uint64_t timestamp = time_micro_sec();
+			if (timestamp <= m_last_timestamp)
+				timestamp = m_last_timestamp + 1;
+			m_last_timestamp = timestamp;
+			slot.timestamp = timestamp;
+			slot.seq = m_write_seq++;
+
+			slot.writing = false;
+			slot.read = false;
+			m_stats.frames_written++;
+
+			if (m_mode == Mode::Latest)
+			{
+				const Slot& last_slot = m_slots[m_last_video_buf];
+				if (last_slot.timestamp != (uint64_t)(-1) && !last_slot.read)
+					m_stats.frames_overwritten++;
+				m_last_video_buf = this_buf;
+			}
+		}
+		m_cond_new_frame.notify_all();
+	}
+
 	void VideoPort::write_image(const Image* image)
 	{
-		int this_buf = (m_last_video_buf + 1) % 3;
-		m_timestamps[this_buf] = time_micro_sec();		
-		std::unique_ptr<Image>& p_this_buf = m_video_bufs[this_buf];
-		if (p_this_buf == nullptr || p_this_buf->width() != image->width() || p_this_buf->height() != image->height() || p_this_buf->has_alpha() != image->has_alpha())
+		ImageRef old_image;
+		std::shared_ptr<Image> p_this_buf;
+		int this_buf = _begin_write(old_image, p_this_buf);
+		if (this_buf < 0) return;
+		old_image = nullptr;
+
+		if (p_this_buf == nullptr || p_this_buf.use_count() > 1 || p_this_buf->width() != image->width() || p_this_buf->height() != image->height() || p_this_buf->format() != image->format())
 		{
-			p_this_buf = std::unique_ptr<Image>(new Image(*image));
+			p_this_buf = std::shared_ptr<Image>(new Image(*image));
 		}
 		else
 		{
 			*p_this_buf = *image;
 		}
-		m_last_video_buf = this_buf;
+
+		_end_write(this_buf, p_this_buf, p_this_buf);
+	}
+
+	void VideoPort::write_image(const ImageRef& image)
+	{
+		// keep a reference, the old frame of the slot is released outside of the lock
+		ImageRef old_image;
+		std::shared_ptr<Image> buffer;
+		int this_buf = _begin_write(old_image, buffer);
+		if (this_buf < 0) return;
+		_end_write(this_buf, image, buffer);
+	}
+
+	VideoPort::Slot& VideoPort::_read_slot() const
+	{
+		if (m_mode == Mode::Lossless && m_read_seq < m_write_seq)
+		{
+			// consume the oldest unread frame, or keep handing out the last one while the queue is empty
+			for (size_t i = 0; i < m_slots.size(); i++)
+			{
+				const Slot& slot = m_slots[i];
+				if (!slot.writing && slot.timestamp != (uint64_t)(-1) && slot.seq == m_read_seq)
+				{
+					m_last_video_buf = (int)i;
+					m_read_seq++;
+					m_pending--;
+					m_cond_space.notify_one();
+					break;
+				}
+			}
+		}
+
+		Slot& slot = m_slots[m_last_video_buf];
+		if (slot.timestamp != (uint64_t)(-1) && !slot.read)
+		{
+			slot.read = true;
+			m_stats.frames_read++;
+		}
+		return slot;
+	}
+
+	uint64_t VideoPort::_peek_timestamp() const
+	{
+		if (m_mode == Mode::Lossless && m_read_seq < m_write_seq)
+		{
+			for (size_t i = 0; i < m_slots.size(); i++)
+			{
+				const Slot& slot = m_slots[i];
+				if (!slot.writing && slot.timestamp != (uint64_t)(-1) && slot.seq == m_read_seq)
+					return slot.timestamp;
+			}
+		}
+		return m_slots[m_last_video_buf].timestamp;
 	}
-	
+
 	const Image* VideoPort::read_image(uint64_t* timestamp) const
 	{
-		*timestamp = m_timestamps[m_last_video_buf];
-		return m_video_bufs[m_last_video_buf].get();
+		std::unique_lock<std::mutex> lock(m_mutex);
+		const Slot& slot = _read_slot();
+		*timestamp = slot.timestamp;
+		return slot.image.get();
+	}
+
+	const Image* VideoPort::lock_image(uint64_t* timestamp) const
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		Slot& slot = _read_slot();
+		*timestamp = slot.timestamp;
+		if (slot.image != nullptr)
+			slot.pin_count++;
+		return slot.image.get();
+	}
+
+	uint64_t VideoPort::peek_timestamp() const
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		return _peek_timestamp();
+	}
+
+	bool VideoPort::wait_image(uint64_t last_timestamp, int timeout_ms) const
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		auto is_new = [this, last_timestamp]()
+		{
+			uint64_t timestamp = _peek_timestamp();
+			return timestamp != (uint64_t)(-1) && timestamp != last_timestamp;
+		};
+		if (timeout_ms < 0)
+		{
+			m_cond_new_frame.wait(lock, is_new);
+			return true;
+		}
+		return m_cond_new_frame.wait_for(lock, std::chrono::milliseconds(timeout_ms), is_new);
+	}
+
+	void VideoPort::request_format(const VideoFormatRequest& request, const void* reader) const
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_requests.set(reader, request);
+	}
+
+	void VideoPort::cancel_format_request(const void* reader) const
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_requests.remove(reader);
+	}
+
+	bool VideoPort::get_format_request(VideoFormatRequest* request) const
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		return m_requests.get(request);
+	}
+
+	void VideoPort::unlock_image(const Image* image) const
+	{
+		if (image == nullptr) return;
+		std::unique_lock<std::mutex> lock(m_mutex);
+		for (size_t i = 0; i < m_slots.size(); i++)
+		{
+			Slot& slot = m_slots[i];
+			if (slot.image.get() == image && slot.pin_count > 0)
+			{
+				slot.pin_count--;
+				break;
+			}
+		}
 	}
 
-}
\ No newline at end of file
+}
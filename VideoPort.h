@@ -1,17 +1,72 @@
 #pragma once
 #include <cstdint>
 #include <memory>
+#include <utility>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
 
 namespace LiveKit
 {
 	class Image;
 
+	// shared, immutable frame; the producer recycles the buffer once every holder has released it
+	typedef std::shared_ptr<const Image> ImageRef;
+
+	// how a consumer would like its frames, so that the producer scales and converts them once while
+	// decoding instead of the consumer doing it again
+	struct VideoFormatRequest
+	{
+		int width = 0; // 0 keeps the source's size, sources never scale up
+		int height = 0;
+		bool packed = false; // planar formats are converted to BGRX, like ImageConverter::to_packed()
+
+		bool operator==(const VideoFormatRequest& other) const
+		{
+			return width == other.width && height == other.height && packed == other.packed;
+		}
+	};
+
+	// the requests of the readers of one source, merged so that no reader gets less than it asked for:
+	// the largest size, and packed frames only when every reader wants them
+	class VideoFormatRequests
+	{
+	public:
+		void set(const void* reader, const VideoFormatRequest& request);
+		void remove(const void* reader);
+
+		// false when no reader has made a request
+		bool get(VideoFormatRequest* request) const;
+
+	private:
+		std::vector<std::pair<const void*, VideoFormatRequest>> m_requests;
+	};
+
 	class VideoSource
 	{
 	public:
 		VideoSource() {}
 		virtual ~VideoSource() {}
 		virtual const Image* read_image(uint64_t* timestamp) const = 0;
+
+		// pins the returned frame until unlock_image() is called, so that it will not be overwritten while being read
+		virtual const Image* lock_image(uint64_t* timestamp) const { return read_image(timestamp); }
+		virtual void unlock_image(const Image* image) const {}
+
+		// timestamp of the latest frame without fetching it, (uint64_t)(-1) when there is none yet
+		virtual uint64_t peek_timestamp() const;
+
+		// blocks until a frame with a timestamp other than 'last_timestamp' is available,
+		// returns false if none arrived within 'timeout_ms' (negative waits forever)
+		virtual bool wait_image(uint64_t last_timestamp, int timeout_ms = -1) const;
+
+		// passes a reader's wish on to whatever produces the frames, sources that cannot scale ignore it.
+		// 'reader' tells the readers of a shared source apart. A reader that wants the frames as they are
+		// requests the default VideoFormatRequest, so that other readers' requests do not shrink them.
+		virtual void request_format(const VideoFormatRequest& request, const void* reader) const {}
+
+		// withdraws the request of a reader that stops reading
+		virtual void cancel_format_request(const void* reader) const {}
 	};
 
 	class VideoTarget
@@ -20,21 +75,90 @@ namespace LiveKit
 		VideoTarget() {}
 		virtual ~VideoTarget() {}
 		virtual void write_image(const Image* image) = 0;
+
+		// targets that can keep a reference to the frame should override this to avoid a copy
+		virtual void write_image(const ImageRef& image) { write_image(image.get()); }
+
+		// what the frames written here should look like, false when anything will do
+		virtual bool get_format_request(VideoFormatRequest* request) const { return false; }
+	};
+
+	struct VideoPortStats
+	{
+		uint64_t frames_written = 0;
+		uint64_t frames_read = 0; // distinct frames handed to readers
+		uint64_t frames_overwritten = 0; // replaced by a newer frame before anyone read them
+		uint64_t frames_dropped = 0; // rejected by a full lossless queue
 	};
 
 	class VideoPort : public VideoTarget, public VideoSource
 	{
 	public:
-		VideoPort();
+		enum class Mode
+		{
+			Latest, // readers always get the newest frame, older unread frames are overwritten
+			Lossless // readers consume frames in order, writers block while 'depth' frames are unread
+		};
+
+		// lossless mode is meant for a single reader, a writer that waits longer than
+		// 'write_timeout_ms' for the reader drops its frame instead (negative waits forever)
+		VideoPort(int depth = 3, Mode mode = Mode::Latest, int write_timeout_ms = 500);
 		~VideoPort();
 
+		Mode mode() const { return m_mode; }
+		int depth() const { return m_depth; }
+
+		VideoPortStats get_stats() const;
+		void reset_stats();
+
 		virtual void write_image(const Image* image);
-		virtual const Image* read_image(uint64_t* timestamp) const;		
+		virtual void write_image(const ImageRef& image);
+		virtual const Image* read_image(uint64_t* timestamp) const;
+
+		virtual const Image* lock_image(uint64_t* timestamp) const;
+		virtual void unlock_image(const Image* image) const;
+
+		virtual uint64_t peek_timestamp() const;
+		virtual bool wait_image(uint64_t last_timestamp, int timeout_ms = -1) const;
+
+		// forwarded to the writer, merged over all readers (see VideoFormatRequests)
+		virtual void request_format(const VideoFormatRequest& request, const void* reader) const;
+		virtual void cancel_format_request(const void* reader) const;
+		virtual bool get_format_request(VideoFormatRequest* request) const;
 
 	private:
-		std::unique_ptr<Image> m_video_bufs[3];
-		uint64_t m_timestamps[3];
-		int m_last_video_buf = 2;
+		struct Slot
+		{
+			ImageRef image;
+			std::shared_ptr<Image> buffer;
+			uint64_t timestamp = (uint64_t)(-1);
+			uint64_t seq = 0;
+			int pin_count = 0;
+			bool writing = false;
+			bool read = false;
+		};
+
+		Mode m_mode;
+		int m_depth;
+		int m_write_timeout_ms;
+
+		mutable std::vector<Slot> m_slots;
+		mutable int m_last_video_buf; // newest frame in Latest mode, last consumed frame in Lossless mode
+		uint64_t m_last_timestamp = 0;
+		uint64_t m_write_seq = 0;
+		mutable uint64_t m_read_seq = 0;
+		mutable int m_pending = 0;
+		mutable VideoPortStats m_stats;
+		mutable VideoFormatRequests m_requests;
+		mutable std::mutex m_mutex;
+		mutable std::condition_variable m_cond_new_frame;
+		mutable std::condition_variable m_cond_space;
+
+		bool _is_pending(const Slot& slot) const { return slot.timestamp != (uint64_t)(-1) && slot.seq >= m_read_seq; }
+		int _begin_write(ImageRef& old_image, std::shared_ptr<Image>& buffer);
+		void _end_write(int this_buf, const ImageRef& image, const std::shared_ptr<Image>& buffer);
+		Slot& _read_slot() const;
+		uint64_t _peek_timestamp() const;
 	};
 
 }
@@ -3,6 +3,7 @@
 #include <GLFW/glfw3.h>
 #include <vector>
 #include "Image.h"
+#include "ImageConverter.h"
 #include "VideoPort.h"
 #include "RenderingOGL.h"
 
@@ -10,6 +11,7 @@ namespace LiveKit
 {
 
 	Viewer::Viewer(int window_width, int window_height, const char* title)
+		: m_converter(new ImageConverter)
 	{
 		glfwInit();
 		m_window = glfwCreateWindow(window_width, window_height, title, NULL, NULL);
@@ -34,29 +36,37 @@ namespace LiveKit
 		if (m_source != nullptr)
 		{
 			uint64_t new_timestamp;
-			const Image* image = m_source->read_image(&new_timestamp);
+			const Image* image = m_source->lock_image(&new_timestamp);
 			if (new_timestamp!=(uint64_t)(-1) && new_timestamp != m_timestamp)
 			{			
 				m_timestamp = new_timestamp;
+				const Image* packed = m_converter->to_packed(image);
 
 				glBindTexture(GL_TEXTURE_2D, m_tex_id);
 				glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+				glPixelStorei(GL_UNPACK_ROW_LENGTH, packed->stride() / packed->pixel_size());
 				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-				if (image->has_alpha())
+				if (packed->has_alpha())
 				{
-					glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image->width(), image->height(), 0, GL_BGRA, GL_UNSIGNED_BYTE, image->data());
+					glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, packed->width(), packed->height(), 0, GL_BGRA, GL_UNSIGNED_BYTE, packed->data());
+				}
+				else if (packed->pixel_size() == 4)
+				{
+					glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, packed->width(), packed->height(), 0, GL_BGRA, GL_UNSIGNED_BYTE, packed->data());
 				}
 				else
 				{
-					glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, image->width(), image->height(), 0, GL_BGR, GL_UNSIGNED_BYTE, image->data());
+					glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, packed->width(), packed->height(), 0, GL_BGR, GL_UNSIGNED_BYTE, packed->data());
 				}
+				glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
 				glBindTexture(GL_TEXTURE_2D, 0);
 
 				m_flipped = image->is_flipped();
 			}
+			m_source->unlock_image(image);
 		}
 
 
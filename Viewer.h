@@ -7,6 +7,7 @@ struct GLFWwindow;
 namespace LiveKit
 {	
 	class VideoSource;
+	class ImageConverter;
 	class Viewer
 	{
 	public:
@@ -26,5 +27,6 @@ namespace LiveKit
 		uint64_t m_timestamp = (uint64_t)(-1);
 		unsigned m_tex_id;
 		bool m_flipped = false;
+		std::unique_ptr<ImageConverter> m_converter;
 	};
 }
\ No newline at end of file
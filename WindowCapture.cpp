@@ -79,7 +79,8 @@ namespace LiveKit
 
 		if (m_image == nullptr || m_image->width() != width || m_image->height() != height)
 		{
-			m_image = (std::unique_ptr<Image>)(new Image(width, height, true));
+			// DIB rows are DWORD aligned, which for 32-bit pixels means tightly packed
+			m_image = (std::unique_ptr<Image>)(new Image(width, height, PixelFormat::BGRA, 4));
 		}
 
 		BITMAPINFOHEADER bi;
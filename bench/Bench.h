@@ -0,0 +1,149 @@
+#pragma once
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+
+namespace LiveKit
+{
+	// Minimal benchmark runner: calibrates the iteration count to a minimum run time, repeats the
+	// measurement and keeps the median. Results are written as JSON so that runs can be diffed.
+	class Bench
+	{
+	public:
+		struct Result
+		{
+			std::string name;
+			uint64_t iterations;
+			double ns_per_iter; // median over the repetitions
+			double ns_per_iter_min;
+			double bytes_per_sec; // 0 when the benchmark does not process a byte count
+		};
+
+		Bench(int argc, char* argv[])
+		{
+			for (int i = 1; i < argc; i++)
+			{
+				const char* arg = argv[i];
+				if (strncmp(arg, "--filter=", 9) == 0)
+					m_filter = arg + 9;
+				else if (strncmp(arg, "--json=", 7) == 0)
+					m_json_path = arg + 7;
+				else if (strncmp(arg, "--min-time=", 11) == 0)
+					m_min_time = atof(arg + 11);
+				else if (strncmp(arg, "--repetitions=", 14) == 0)
+					m_repetitions = atoi(arg + 14);
+				else if (strcmp(arg, "--list") == 0)
+					m_list_only = true;
+				else
+				{
+					printf("usage: %s [--filter=substring] [--json=file] [--min-time=seconds] [--repetitions=n] [--list]\n", argv[0]);
+					m_list_only = true;
+				}
+			}
+			if (m_repetitions < 1) m_repetitions = 1;
+		}
+
+		bool enabled(const std::string& name) const
+		{
+			return m_filter.empty() || name.find(m_filter) != std::string::npos;
+		}
+
+		// 'body' runs one iteration, 'bytes' is the amount of data it processes
+		void run(const std::string& name, size_t bytes, const std::function<void()>& body)
+		{
+			if (!enabled(name)) return;
+			if (m_list_only)
+			{
+				printf("%s\n", name.c_str());
+				return;
+			}
+
+			uint64_t iterations = 1;
+			while (true)
+			{
+				double t = s_time(body, iterations);
+				if (t >= m_min_time || iterations >= ((uint64_t)1 << 40)) break;
+				double scale = t > 0.0 ? m_min_time * 1.2 / t : 100.0;
+				if (scale > 100.0) scale = 100.0;
+				if (scale < 2.0) scale = 2.0;
+				iterations = (uint64_t)((double)iterations * scale);
+			}
+
+			std::vector<double> samples;
+			for (int i = 0; i < m_repetitions; i++)
+				samples.push_back(s_time(body, iterations) * 1e9 / (double)iterations);
+			std::sort(samples.begin(), samples.end());
+
+			Result result;
+			result.name = name;
+			result.iterations = iterations;
+			result.ns_per_iter = samples[samples.size() / 2];
+			result.ns_per_iter_min = samples[0];
+			result.bytes_per_sec = bytes > 0 ? (double)bytes * 1e9 / result.ns_per_iter : 0.0;
+			m_results.push_back(result);
+
+			if (bytes > 0)
+				fprintf(stderr, "%-48s %14.1f ns %10.2f GB/s\n", name.c_str(), result.ns_per_iter, result.bytes_per_sec / 1e9);
+			else
+				fprintf(stderr, "%-48s %14.1f ns\n", name.c_str(), result.ns_per_iter);
+		}
+
+		bool write_json() const
+		{
+			if (m_list_only) return true;
+			FILE* fp = stdout;
+			if (!m_json_path.empty())
+			{
+				fp = fopen(m_json_path.c_str(), "w");
+				if (fp == nullptr)
+				{
+					printf("Failed writing %s\n", m_json_path.c_str());
+					return false;
+				}
+			}
+			fprintf(fp, "{\n  \"min_time\": %g,\n  \"repetitions\": %d,\n  \"benchmarks\": [\n", m_min_time, m_repetitions);
+			for (size_t i = 0; i < m_results.size(); i++)
+			{
+				const Result& r = m_results[i];
+				fprintf(fp, "    { \"name\": \"%s\", \"iterations\": %llu, \"ns_per_iter\": %.3f, \"ns_per_iter_min\": %.3f, \"bytes_per_sec\": %.1f }%s\n",
+					r.name.c_str(), (unsigned long long)r.iterations, r.ns_per_iter, r.ns_per_iter_min, r.bytes_per_sec,
+					i + 1 < m_results.size() ? "," : "");
+			}
+			fprintf(fp, "  ]\n}\n");
+			if (fp != stdout) fclose(fp);
+			return true;
+		}
+
+	private:
+		std::string m_filter;
+		std::string m_json_path;
+		double m_min_time = 0.2;
+		int m_repetitions = 5;
+		bool m_list_only = false;
+		std::vector<Result> m_results;
+
+		static double s_time(const std::function<void()>& body, uint64_t iterations)
+		{
+			auto start = std::chrono::steady_clock::now();
+			for (uint64_t i = 0; i < iterations; i++)
+				body();
+			return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		}
+	};
+
+	// keeps the compiler from optimising away results that are otherwise unused
+	template <typename T>
+	inline void do_not_optimize(const T& value)
+	{
+		static volatile const void* s_sink;
+		s_sink = &value;
+	}
+
+}
@@ -0,0 +1,230 @@
+#include <DecoderOptions.h>
+#include <Decoder.h>
+using namespace LiveKit;
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <chrono>
+
+// Video decoding with different threading configurations, on packets read into memory beforehand so
+// that only the decoder is measured. Throughput is in frames per second, delay is how many packets go
+// in before the first frame comes out (frame threading adds one per thread). Compare resolutions by
+// passing several clips, e.g.:
+//   ffmpeg -f lavfi -i testsrc2=size=1920x1080:rate=30 -t 20 -c:v libx264 -bf 3 clip_1080p.mp4
+//   ffmpeg -f lavfi -i testsrc2=size=3840x2160:rate=30 -t 20 -c:v libx264 -bf 3 clip_4k.mp4
+//   livekit_decoderbench clip_1080p.mp4 clip_4k.mp4 --frames=600 --json=decoder.json
+
+struct Config
+{
+	const char* name;
+	DecoderOptions options;
+};
+
+static std::vector<Config> s_configs()
+{
+	std::vector<Config> configs;
+	Config c;
+	c.name = "single";
+	configs.push_back(c);
+
+	c.name = "default_auto";
+	c.options.thread_count = 0;
+	configs.push_back(c);
+
+	c.name = "frame_auto";
+	c.options.thread_type = DecoderThreading::Frame;
+	configs.push_back(c);
+
+	c.name = "slice_auto";
+	c.options.thread_type = DecoderThreading::Slice;
+	configs.push_back(c);
+
+	c.name = "slice_auto_low_delay";
+	c.options.low_delay = true;
+	configs.push_back(c);
+
+	c.name = "frame_auto_skip_nonref";
+	c.options = DecoderOptions();
+	c.options.thread_count = 0;
+	c.options.thread_type = DecoderThreading::Frame;
+	c.options.skip_frame = DecoderSkip::NonRef;
+	c.options.skip_loop_filter = DecoderSkip::NonRef;
+	configs.push_back(c);
+	return configs;
+}
+
+struct Result
+{
+	std::string file;
+	std::string config;
+	int width, height;
+	int packets;
+	int frames;
+	double open_ms;
+	double first_frame_ms;
+	int delay_packets;
+	double fps;
+};
+
+static double s_ms_since(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static bool s_read_packets(const char* fn, int max_packets, AVCodecParameters** codec_par, std::vector<AVPacket*>& packets)
+{
+	AVFormatContext* fmt_ctx = nullptr;
+	if (avformat_open_input(&fmt_ctx, fn, nullptr, nullptr) != 0) return false;
+	avformat_find_stream_info(fmt_ctx, nullptr);
+	int stream_index = av_find_best_stream(fmt_ctx, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+	if (stream_index < 0)
+	{
+		avformat_close_input(&fmt_ctx);
+		return false;
+	}
+	*codec_par = avcodec_parameters_alloc();
+	avcodec_parameters_copy(*codec_par, fmt_ctx->streams[stream_index]->codecpar);
+
+	AVPacket* packet = av_packet_alloc();
+	while ((int)packets.size() < max_packets && av_read_frame(fmt_ctx, packet) == 0)
+	{
+		if (packet->stream_index == stream_index)
+		{
+			packets.push_back(packet);
+			packet = av_packet_alloc();
+		}
+		else
+		{
+			av_packet_unref(packet);
+		}
+	}
+	av_packet_free(&packet);
+	avformat_close_input(&fmt_ctx);
+	return packets.size() > 0;
+}
+
+static Result s_run(const char* fn, const Config& config, const AVCodecParameters* codec_par, const std::vector<AVPacket*>& packets)
+{
+	Result r;
+	r.file = fn;
+	r.config = config.name;
+	r.width = codec_par->width;
+	r.height = codec_par->height;
+	r.packets = (int)packets.size();
+	r.frames = 0;
+	r.first_frame_ms = 0.0;
+	r.delay_packets = 0;
+
+	auto t0 = std::chrono::steady_clock::now();
+	AVCodecContext* codec_ctx = open_decoder(codec_par, config.options);
+	r.open_ms = s_ms_since(t0);
+
+	AVFrame* frame = av_frame_alloc();
+	AVPacket* packet = av_packet_alloc();
+	int sent = 0;
+	auto receive = [&]()
+	{
+		while (avcodec_receive_frame(codec_ctx, frame) == 0)
+		{
+			if (r.frames == 0)
+			{
+				r.first_frame_ms = s_ms_since(t0);
+				r.delay_packets = sent;
+			}
+			r.frames++;
+			av_frame_unref(frame);
+		}
+	};
+
+	t0 = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < packets.size(); i++)
+	{
+		av_packet_ref(packet, packets[i]);
+		avcodec_send_packet(codec_ctx, packet);
+		av_packet_unref(packet);
+		sent++;
+		receive();
+	}
+	avcodec_send_packet(codec_ctx, nullptr);
+	receive();
+	double ms = s_ms_since(t0);
+	r.fps = ms > 0.0 ? (double)r.frames * 1000.0 / ms : 0.0;
+
+	av_packet_free(&packet);
+	av_frame_free(&frame);
+	avcodec_free_context(&codec_ctx);
+
+	fprintf(stderr, "%-24s %5dx%-5d %8.1f fps  delay %3d packets  first frame %8.2f ms  open %7.2f ms\n",
+		config.name, r.width, r.height, r.fps, r.delay_packets, r.first_frame_ms, r.open_ms);
+	return r;
+}
+
+int main(int argc, char* argv[])
+{
+	std::vector<const char*> files;
+	int max_frames = 600;
+	std::string filter;
+	std::string json_path;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strncmp(argv[i], "--frames=", 9) == 0)
+			max_frames = atoi(argv[i] + 9);
+		else if (strncmp(argv[i], "--filter=", 9) == 0)
+			filter = argv[i] + 9;
+		else if (strncmp(argv[i], "--json=", 7) == 0)
+			json_path = argv[i] + 7;
+		else if (argv[i][0] != '-')
+			files.push_back(argv[i]);
+	}
+	if (files.size() == 0 || max_frames < 1)
+	{
+		printf("usage: %s video_file... [--frames=n] [--filter=config] [--json=file]\n", argv[0]);
+		return 1;
+	}
+
+	std::vector<Config> configs = s_configs();
+	std::vector<Result> results;
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		AVCodecParameters* codec_par = nullptr;
+		std::vector<AVPacket*> packets;
+		if (!s_read_packets(files[i], max_frames, &codec_par, packets))
+		{
+			printf("Failed loading %s\n", files[i]);
+			return 1;
+		}
+		fprintf(stderr, "%s: %zu packets\n", files[i], packets.size());
+		for (size_t j = 0; j < configs.size(); j++)
+		{
+			if (!filter.empty() && strstr(configs[j].name, filter.c_str()) == nullptr) continue;
+			results.push_back(s_run(files[i], configs[j], codec_par, packets));
+		}
+		for (size_t j = 0; j < packets.size(); j++)
+			av_packet_free(&packets[j]);
+		avcodec_parameters_free(&codec_par);
+	}
+
+	FILE* fp = stdout;
+	if (!json_path.empty())
+	{
+		fp = fopen(json_path.c_str(), "w");
+		if (fp == nullptr)
+		{
+			printf("Failed writing %s\n", json_path.c_str());
+			return 1;
+		}
+	}
+	fprintf(fp, "{\n  \"frames\": %d,\n  \"results\": [\n", max_frames);
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const Result& r = results[i];
+		fprintf(fp, "    { \"file\": \"%s\", \"config\": \"%s\", \"width\": %d, \"height\": %d, \"frames\": %d, \"fps\": %.2f, \"delay_packets\": %d, \"first_frame_ms\": %.3f, \"open_ms\": %.3f }%s\n",
+			r.file.c_str(), r.config.c_str(), r.width, r.height, r.frames, r.fps, r.delay_packets, r.first_frame_ms, r.open_ms, i + 1 < results.size() ? "," : "");
+	}
+	fprintf(fp, "  ]\n}\n");
+	if (fp != stdout) fclose(fp);
+	return 0;
+}
@@ -0,0 +1,340 @@
+#include "Bench.h"
+#include <Image.h>
+#include <ImageCopy.h>
+#include <ImageConverter.h>
+#include <SliceScaler.h>
+#include <WorkerPool.h>
+#include <ImageRecycler.h>
+#include <AudioMix.h>
+#include <AudioBuffer.h>
+#include <BufferQueue.h>
+#include <VideoPort.h>
+#include <cstdio>
+#include <vector>
+#include <memory>
+#include <string>
+
+extern "C" {
+#include <libswscale/swscale.h>
+}
+
+using namespace LiveKit;
+
+struct Resolution
+{
+	const char* name;
+	int width;
+	int height;
+};
+
+static const Resolution s_resolutions[] =
+{
+	{ "720p", 1280, 720 },
+	{ "1080p", 1920, 1080 },
+	{ "4K", 3840, 2160 }
+};
+
+static const char* s_simd_name(SimdLevel level)
+{
+	switch (level)
+	{
+	case SimdLevel::SSE4:
+		return "sse4";
+	case SimdLevel::AVX2:
+		return "avx2";
+	default:
+		return "scalar";
+	}
+}
+
+static void s_fill(Image& img)
+{
+	uint32_t x = 12345;
+	for (int i = 0; i < img.num_planes(); i++)
+	{
+		uint8_t* p = img.data(i);
+		size_t size = (size_t)img.stride(i) * img.plane_height(i);
+		for (size_t j = 0; j < size; j++)
+		{
+			x = x * 1664525 + 1013904223;
+			p[j] = (uint8_t)(x >> 24);
+		}
+	}
+}
+
+static void bench_copy_centered(Bench& bench)
+{
+	SimdLevel max_level = max_simd_level();
+	for (const Resolution& res : s_resolutions)
+	{
+		Image bgr(res.width, res.height, PixelFormat::BGR24);
+		Image bgrx(res.width, res.height, PixelFormat::BGRX);
+		Image bgr_out(res.width, res.height, PixelFormat::BGR24);
+		Image bgrx_out(res.width, res.height, PixelFormat::BGRX);
+		s_fill(bgr);
+		s_fill(bgrx);
+
+		for (int l = 0; l <= (int)max_level; l++)
+		{
+			SimdLevel level = (SimdLevel)l;
+			set_simd_level(level);
+			std::string suffix = std::string(res.name) + "/" + s_simd_name(level);
+
+			bench.run("copy_centered/3to3/" + suffix, (size_t)res.width * res.height * 3, [&]()
+			{
+				copy_centered(bgr.data(), res.width, res.height, 3, bgr.stride(), bgr_out.data(), res.width, res.height, 3, bgr_out.stride(), false);
+			});
+			bench.run("copy_centered/3to4/" + suffix, (size_t)res.width * res.height * 4, [&]()
+			{
+				copy_centered(bgr.data(), res.width, res.height, 3, bgr.stride(), bgrx_out.data(), res.width, res.height, 4, bgrx_out.stride(), false);
+			});
+			bench.run("copy_centered/4to3/" + suffix, (size_t)res.width * res.height * 3, [&]()
+			{
+				copy_centered(bgrx.data(), res.width, res.height, 4, bgrx.stride(), bgr_out.data(), res.width, res.height, 3, bgr_out.stride(), false);
+			});
+			bench.run("copy_centered/4to4_flip/" + suffix, (size_t)res.width * res.height * 4, [&]()
+			{
+				copy_centered(bgrx.data(), res.width, res.height, 4, bgrx.stride(), bgrx_out.data(), res.width, res.height, 4, bgrx_out.stride(), true);
+			});
+		}
+		set_simd_level(max_level);
+
+		// output of a different size: the input is cropped horizontally and padded vertically
+		int w_out = res.width * 3 / 4;
+		int h_out = res.height * 5 / 4;
+		Image padded(w_out, h_out, PixelFormat::BGRX);
+		bench.run(std::string("copy_centered/crop_pad_3to4/") + res.name, (size_t)w_out * h_out * 4, [&]()
+		{
+			copy_centered(bgr.data(), res.width, res.height, 3, bgr.stride(), padded.data(), w_out, h_out, 4, padded.stride(), false);
+		});
+	}
+}
+
+static void bench_image_copy(Bench& bench)
+{
+	const PixelFormat formats[] = { PixelFormat::BGRX, PixelFormat::I420 };
+	const char* format_names[] = { "bgrx", "i420" };
+	for (const Resolution& res : s_resolutions)
+	{
+		for (int f = 0; f < 2; f++)
+		{
+			Image src(res.width, res.height, formats[f]);
+			s_fill(src);
+			size_t bytes = Image::s_buffer_size(res.width, res.height, formats[f], src.stride());
+			std::string suffix = std::string(format_names[f]) + "/" + res.name;
+
+			bench.run("image/copy_construct/" + suffix, bytes, [&]()
+			{
+				Image dst(src);
+				do_not_optimize(dst);
+			});
+
+			Image dst(res.width, res.height, formats[f]);
+			bench.run("image/assign/" + suffix, bytes, [&]()
+			{
+				dst = src;
+			});
+
+			// rows of the destination padded differently, taking the per-row path
+			Image dst_packed(res.width, res.height, formats[f], 1);
+			bench.run("image/assign_restride/" + suffix, bytes, [&]()
+			{
+				dst_packed = src;
+			});
+		}
+	}
+}
+
+static void bench_video_port(Bench& bench)
+{
+	for (const Resolution& res : s_resolutions)
+	{
+		size_t bytes = (size_t)Image::s_default_stride(res.width, PixelFormat::BGRX) * res.height;
+
+		Image frame(res.width, res.height, PixelFormat::BGRX);
+		s_fill(frame);
+
+		VideoPort port_copy;
+		bench.run(std::string("video_port/write_copy/") + res.name, bytes, [&]()
+		{
+			port_copy.write_image(&frame);
+		});
+
+		VideoPort port_ref;
+		ImageRecycler recycler;
+		bench.run(std::string("video_port/write_ref/") + res.name, 0, [&]()
+		{
+			std::shared_ptr<Image> img = recycler.get(res.width, res.height, PixelFormat::BGRX);
+			port_ref.write_image(ImageRef(img));
+		});
+
+		bench.run(std::string("video_port/write_lock_unlock/") + res.name, bytes, [&]()
+		{
+			port_copy.write_image(&frame);
+			uint64_t timestamp;
+			const Image* img = port_copy.lock_image(&timestamp);
+			do_not_optimize(img);
+			port_copy.unlock_image(img);
+		});
+
+		bench.run(std::string("video_port/read_image/") + res.name, 0, [&]()
+		{
+			uint64_t timestamp;
+			const Image* img = port_copy.read_image(&timestamp);
+			do_not_optimize(img);
+		});
+	}
+}
+
+static void bench_audio(Bench& bench)
+{
+	// AudioPort works on 10ms buffers of interleaved stereo at 48kHz
+	const size_t buf_size = 480;
+	const size_t ring_len = 48000;
+	std::vector<float> ring(ring_len * 2);
+	std::vector<short> s16(buf_size * 2);
+	std::vector<float> mix(buf_size * 2);
+	for (size_t i = 0; i < s16.size(); i++)
+		s16[i] = (short)((i * 7919) % 65536 - 32768);
+
+	size_t pos = 0;
+	bench.run("audio/s16_to_float_ring", buf_size * 4, [&]()
+	{
+		s16_to_float_ring(s16.data(), ring.data(), ring_len, pos, buf_size);
+		pos = (pos + buf_size) % ring_len;
+	});
+
+	double fpos = 0.0;
+	bench.run("audio/mix_resampled/48000to48000", buf_size * 8, [&]()
+	{
+		mix_resampled(ring.data(), ring_len, fpos, 1.0, 0.8f, mix.data(), buf_size);
+		fpos += (double)buf_size;
+		if (fpos >= (double)ring_len) fpos -= (double)ring_len;
+	});
+
+	const double delta = 44100.0 / 48000.0;
+	fpos = 0.0;
+	bench.run("audio/mix_resampled/44100to48000", buf_size * 8, [&]()
+	{
+		mix_resampled(ring.data(), ring_len, fpos, delta, 0.8f, mix.data(), buf_size);
+		fpos += delta * (double)buf_size;
+		if (fpos >= (double)ring_len) fpos -= (double)ring_len;
+	});
+
+	bench.run("audio/float_to_s16", buf_size * 4, [&]()
+	{
+		float_to_s16(mix.data(), s16.data(), buf_size);
+	});
+
+	BufferQueue queue;
+	std::vector<AudioBuffer*> buffers;
+	for (int i = 0; i < 4; i++)
+		buffers.push_back(new AudioBuffer(2, (int)buf_size));
+	bench.run("audio/buffer_queue_push_pop", 0, [&]()
+	{
+		for (size_t i = 0; i < buffers.size(); i++)
+			queue.PushBuffer(buffers[i]);
+		for (size_t i = 0; i < buffers.size(); i++)
+			buffers[i] = queue.PopBuffer();
+	});
+	for (size_t i = 0; i < buffers.size(); i++)
+		delete buffers[i];
+}
+
+static void bench_sws(Bench& bench)
+{
+	struct Config
+	{
+		const char* name;
+		PixelFormat in;
+		PixelFormat out;
+	};
+	const Config configs[] =
+	{
+		{ "i420_to_bgrx", PixelFormat::I420, PixelFormat::BGRX },
+		{ "i420_to_bgr24", PixelFormat::I420, PixelFormat::BGR24 },
+		{ "nv12_to_bgrx", PixelFormat::NV12, PixelFormat::BGRX },
+		{ "bgrx_to_i420", PixelFormat::BGRX, PixelFormat::I420 },
+		{ "bgr24_to_bgrx", PixelFormat::BGR24, PixelFormat::BGRX }
+	};
+
+	for (const Resolution& res : s_resolutions)
+	{
+		for (const Config& config : configs)
+		{
+			Image in(res.width, res.height, config.in);
+			s_fill(in);
+			ImageConverter converter;
+			size_t bytes = (size_t)res.width * res.height * Image::s_pixel_size(PixelFormat::BGRX);
+			bench.run(std::string("sws/") + config.name + "/" + res.name, bytes, [&]()
+			{
+				const Image* out = converter.convert(&in, config.out);
+				do_not_optimize(out);
+			});
+		}
+	}
+}
+
+// the same conversions as sws/, split over pools of different sizes to show how slicing scales with cores
+static void bench_slice_scale(Bench& bench)
+{
+	struct Config
+	{
+		const char* name;
+		PixelFormat in;
+		PixelFormat out;
+		int flags;
+	};
+	const Config configs[] =
+	{
+		{ "i420_to_bgrx", PixelFormat::I420, PixelFormat::BGRX, SWS_BICUBIC },
+		{ "bgrx_to_i420", PixelFormat::BGRX, PixelFormat::I420, SWS_BILINEAR }
+	};
+	const int thread_counts[] = { 0, 1, 3, 7 };
+
+	for (int num_threads : thread_counts)
+	{
+		WorkerPool pool(num_threads);
+		for (const Resolution& res : s_resolutions)
+		{
+			if (res.height < 1080) continue;
+			for (const Config& config : configs)
+			{
+				Image in(res.width, res.height, config.in);
+				Image out(res.width, res.height, config.out);
+				s_fill(in);
+				SliceScaler scaler(config.flags, &pool);
+
+				const uint8_t* src_data[4] = { in.data(0), in.data(1), in.data(2), nullptr };
+				int src_linesize[4] = { in.stride(0), in.stride(1), in.stride(2), 0 };
+				uint8_t* dst_data[4] = { out.data(0), out.data(1), out.data(2), nullptr };
+				int dst_linesize[4] = { out.stride(0), out.stride(1), out.stride(2), 0 };
+				int src_fmt = ImageConverter::s_av_pix_fmt(config.in);
+				int dst_fmt = ImageConverter::s_av_pix_fmt(config.out);
+
+				size_t bytes = (size_t)res.width * res.height * Image::s_pixel_size(PixelFormat::BGRX);
+				std::string name = std::string("slice_scale/") + config.name + "/" + res.name + "/threads=" + std::to_string(num_threads + 1);
+				bench.run(name, bytes, [&]()
+				{
+					scaler.scale(src_data, src_linesize, res.width, res.height, src_fmt, dst_data, dst_linesize, res.width, res.height, dst_fmt);
+					do_not_optimize(dst_data[0]);
+				});
+			}
+		}
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	Bench bench(argc, argv);
+	fprintf(stderr, "simd level: %s\n", s_simd_name(max_simd_level()));
+
+	bench_copy_centered(bench);
+	bench_image_copy(bench);
+	bench_video_port(bench);
+	bench_audio(bench);
+	bench_sws(bench);
+	bench_slice_scale(bench);
+
+	return bench.write_json() ? 0 : 1;
+}
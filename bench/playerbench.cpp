@@ -0,0 +1,225 @@
+#include <Player.h>
+#include <VideoPort.h>
+#include <Image.h>
+using namespace LiveKit;
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <random>
+#include <algorithm>
+
+// Seek latency of a playing Player, the way a timeline scrubber drives it: set_position() to a random
+// point, let it play for a short while, seek again. Reports how long set_position() blocks the caller
+// and how long until the first frame from the new position reaches the target. Run it on builds
+// before and after a change to the seek path to compare, e.g.:
+//   livekit_playerbench input.mp4 --seeks=200 --dwell=30 --json=player_seek.json
+// The audio device stays open for the whole run unless --no-audio is given.
+//
+// With --live, it receives a network stream in live mode instead, sampling the latency behind the
+// live edge for --seconds and counting catch-ups. A stream served on loopback does for a test, e.g.:
+//   ffmpeg -re -i input.mp4 -c copy -f mpegts udp://127.0.0.1:1234
+//   livekit_playerbench udp://127.0.0.1:1234 --live --target=300 --seconds=60 --json=player_live.json
+
+class FrameClock : public VideoTarget
+{
+public:
+	virtual void write_image(const Image* image)
+	{
+		m_frames++;
+	}
+
+	uint64_t frames() const { return m_frames; }
+
+	// the first frame written after 'count' frames, false on timeout
+	bool wait_beyond(uint64_t count, double timeout_ms) const
+	{
+		auto start = std::chrono::steady_clock::now();
+		while (m_frames <= count)
+		{
+			if (std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() > timeout_ms)
+				return false;
+			std::this_thread::yield();
+		}
+		return true;
+	}
+
+private:
+	std::atomic<uint64_t> m_frames{ 0 };
+};
+
+struct Distribution
+{
+	std::string name;
+	double min, p50, p90, p99, max;
+	int count;
+};
+
+static Distribution s_summarize(const char* name, std::vector<double>& ms)
+{
+	std::sort(ms.begin(), ms.end());
+	Distribution d;
+	d.name = name;
+	d.count = (int)ms.size();
+	auto at = [&](double q) { return ms[(size_t)(q * (double)(ms.size() - 1) + 0.5)]; };
+	d.min = at(0.0);
+	d.p50 = at(0.5);
+	d.p90 = at(0.9);
+	d.p99 = at(0.99);
+	d.max = at(1.0);
+	fprintf(stderr, "%-12s min %8.2f  p50 %8.2f  p90 %8.2f  p99 %8.2f  max %8.2f ms\n", name, d.min, d.p50, d.p90, d.p99, d.max);
+	return d;
+}
+
+static double s_ms_since(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static FILE* s_open_json(const std::string& json_path)
+{
+	if (json_path.empty()) return stdout;
+	FILE* fp = fopen(json_path.c_str(), "w");
+	if (fp == nullptr)
+		printf("Failed writing %s\n", json_path.c_str());
+	return fp;
+}
+
+static int s_run_live(const char* url, bool play_audio, int target_ms, int seconds, const std::string& json_path)
+{
+	Player player(url, play_audio, true, 0, true, true);
+	player.set_target_latency((uint64_t)target_ms * 1000);
+	FrameClock target;
+	player.AddTarget(&target);
+	player.start();
+	if (!target.wait_beyond(0, 10000.0))
+	{
+		printf("No video received from %s\n", url);
+		return 1;
+	}
+
+	std::vector<double> latency_ms;
+	auto t0 = std::chrono::steady_clock::now();
+	while (s_ms_since(t0) < seconds * 1000.0)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		LiveStats stats;
+		player.get_live_stats(&stats);
+		latency_ms.push_back((double)stats.latency / 1000.0);
+	}
+	LiveStats stats;
+	player.get_live_stats(&stats);
+	uint64_t frames = target.frames();
+	player.stop();
+
+	fprintf(stderr, "%s: %d s, target %d ms, %llu catch-ups dropping %.1f ms, %llu frames\n", url, seconds, target_ms,
+		(unsigned long long)stats.catch_ups, (double)stats.dropped_duration / 1000.0, (unsigned long long)frames);
+	Distribution d = s_summarize("latency", latency_ms);
+
+	FILE* fp = s_open_json(json_path);
+	if (fp == nullptr) return 1;
+	fprintf(fp, "{\n  \"url\": \"%s\",\n  \"audio\": %s,\n  \"target_ms\": %d,\n  \"catch_ups\": %llu,\n  \"dropped_ms\": %.3f,\n  \"frames\": %llu,\n",
+		url, play_audio ? "true" : "false", target_ms, (unsigned long long)stats.catch_ups, (double)stats.dropped_duration / 1000.0, (unsigned long long)frames);
+	fprintf(fp, "  \"latency\": { \"count\": %d, \"min_ms\": %.3f, \"p50_ms\": %.3f, \"p90_ms\": %.3f, \"p99_ms\": %.3f, \"max_ms\": %.3f }\n}\n",
+		d.count, d.min, d.p50, d.p90, d.p99, d.max);
+	if (fp != stdout) fclose(fp);
+	return 0;
+}
+
+int main(int argc, char* argv[])
+{
+	const char* fn = nullptr;
+	int num_seeks = 200;
+	int dwell_ms = 30;
+	bool play_audio = true;
+	bool live = false;
+	int target_ms = 500;
+	int seconds = 30;
+	std::string json_path;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strncmp(argv[i], "--seeks=", 8) == 0)
+			num_seeks = atoi(argv[i] + 8);
+		else if (strncmp(argv[i], "--dwell=", 8) == 0)
+			dwell_ms = atoi(argv[i] + 8);
+		else if (strcmp(argv[i], "--no-audio") == 0)
+			play_audio = false;
+		else if (strcmp(argv[i], "--live") == 0)
+			live = true;
+		else if (strncmp(argv[i], "--target=", 9) == 0)
+			target_ms = atoi(argv[i] + 9);
+		else if (strncmp(argv[i], "--seconds=", 10) == 0)
+			seconds = atoi(argv[i] + 10);
+		else if (strncmp(argv[i], "--json=", 7) == 0)
+			json_path = argv[i] + 7;
+		else if (argv[i][0] != '-' && fn == nullptr)
+			fn = argv[i];
+	}
+	if (fn == nullptr || num_seeks < 1)
+	{
+		printf("usage: %s media_file [--seeks=n] [--dwell=ms] [--no-audio] [--json=file]\n", argv[0]);
+		printf("       %s url --live [--target=ms] [--seconds=n] [--no-audio] [--json=file]\n", argv[0]);
+		return 1;
+	}
+	if (live)
+		return s_run_live(fn, play_audio, target_ms, seconds, json_path);
+
+	Player player(fn, play_audio, true);
+	if (player.video_width() == 0 || player.get_duration() == 0)
+	{
+		printf("Failed loading %s\n", fn);
+		return 1;
+	}
+	FrameClock target;
+	player.AddTarget(&target);
+	player.start();
+	target.wait_beyond(0, 5000.0);
+
+	std::mt19937 rng(1);
+	uint64_t duration = player.get_duration();
+	std::vector<double> call_ms, frame_ms;
+	int timeouts = 0;
+	for (int i = 0; i < num_seeks; i++)
+	{
+		// stay clear of the very end, where there may be no frame left to show
+		uint64_t pos = (uint64_t)(rng() % 1000) * (duration * 9 / 10) / 1000;
+
+		uint64_t frames = target.frames();
+		auto t0 = std::chrono::steady_clock::now();
+		player.set_position(pos);
+		call_ms.push_back(s_ms_since(t0));
+
+		// frames in flight when set_position() returns belong to the new position already
+		if (target.wait_beyond(frames, 2000.0))
+			frame_ms.push_back(s_ms_since(t0));
+		else
+			timeouts++;
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(dwell_ms));
+	}
+	player.stop();
+
+	fprintf(stderr, "%s: %d seeks, %d ms apart, %d without a frame\n", fn, num_seeks, dwell_ms, timeouts);
+	std::vector<Distribution> results;
+	results.push_back(s_summarize("call", call_ms));
+	if (frame_ms.size() > 0)
+		results.push_back(s_summarize("first_frame", frame_ms));
+
+	FILE* fp = s_open_json(json_path);
+	if (fp == nullptr) return 1;
+	fprintf(fp, "{\n  \"file\": \"%s\",\n  \"dwell_ms\": %d,\n  \"audio\": %s,\n  \"timeouts\": %d,\n  \"latencies\": [\n", fn, dwell_ms, play_audio ? "true" : "false", timeouts);
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const Distribution& d = results[i];
+		fprintf(fp, "    { \"name\": \"%s\", \"count\": %d, \"min_ms\": %.3f, \"p50_ms\": %.3f, \"p90_ms\": %.3f, \"p99_ms\": %.3f, \"max_ms\": %.3f }%s\n",
+			d.name.c_str(), d.count, d.min, d.p50, d.p90, d.p99, d.max, i + 1 < results.size() ? "," : "");
+	}
+	fprintf(fp, "  ]\n}\n");
+	if (fp != stdout) fclose(fp);
+	return 0;
+}
@@ -0,0 +1,256 @@
+#include <KeyframeIndex.h>
+using namespace LiveKit;
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+}
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <random>
+#include <algorithm>
+
+// Seek latency distribution of the demuxer's own search followed by a dts-compared decode (how Player
+// and LazyPlayer used to seek), against KeyframeIndex followed by decode_to_frame(). Each seek asks for
+// a random frame of the file, a seek is exact when the frame it produces is that frame.
+// Long GOPs show the difference best, e.g.:
+//   ffmpeg -i input.mp4 -an -c:v libx264 -g 600 -bf 3 long_gop.mp4
+//   livekit_seekbench long_gop.mp4 --seeks=200 --json=seek.json
+
+struct Media
+{
+	AVFormatContext* fmt_ctx = nullptr;
+	AVCodecContext* codec_ctx = nullptr;
+	AVPacket* packet = nullptr;
+	AVFrame* frame = nullptr;
+	int stream_index = -1;
+	AVRational time_base;
+
+	bool open(const char* fn)
+	{
+		if (avformat_open_input(&fmt_ctx, fn, nullptr, nullptr) != 0) return false;
+		avformat_find_stream_info(fmt_ctx, nullptr);
+		for (unsigned i = 0; i < fmt_ctx->nb_streams; i++)
+		{
+			if (fmt_ctx->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO)
+			{
+				stream_index = i;
+				break;
+			}
+		}
+		if (stream_index < 0) return false;
+		time_base = fmt_ctx->streams[stream_index]->time_base;
+
+		AVCodecParameters* p_codec_par = fmt_ctx->streams[stream_index]->codecpar;
+		AVCodec* p_codec = avcodec_find_decoder(p_codec_par->codec_id);
+		codec_ctx = avcodec_alloc_context3(p_codec);
+		avcodec_parameters_to_context(codec_ctx, p_codec_par);
+		avcodec_open2(codec_ctx, p_codec, nullptr);
+		packet = av_packet_alloc();
+		frame = av_frame_alloc();
+		return true;
+	}
+
+	~Media()
+	{
+		av_frame_free(&frame);
+		av_packet_free(&packet);
+		avcodec_free_context(&codec_ctx);
+		avformat_close_input(&fmt_ctx);
+	}
+
+	int64_t to_micro_sec(int64_t pts) const
+	{
+		return pts * time_base.num * AV_TIME_BASE / time_base.den;
+	}
+
+	int64_t to_pts(int64_t t) const
+	{
+		return av_rescale(t, time_base.den, (int64_t)time_base.num * AV_TIME_BASE);
+	}
+};
+
+struct Seek
+{
+	double ms;
+	int frames;
+	bool exact;
+};
+
+struct Distribution
+{
+	std::string name;
+	double min, p50, p90, p99, max, mean_frames;
+	int exact, count;
+};
+
+static Distribution s_summarize(const char* name, std::vector<Seek>& seeks)
+{
+	std::sort(seeks.begin(), seeks.end(), [](const Seek& a, const Seek& b) { return a.ms < b.ms; });
+	Distribution d;
+	d.name = name;
+	d.count = (int)seeks.size();
+	auto at = [&](double q) { return seeks[(size_t)(q * (double)(seeks.size() - 1) + 0.5)].ms; };
+	d.min = at(0.0);
+	d.p50 = at(0.5);
+	d.p90 = at(0.9);
+	d.p99 = at(0.99);
+	d.max = at(1.0);
+	d.exact = 0;
+	double frames = 0.0;
+	for (size_t i = 0; i < seeks.size(); i++)
+	{
+		if (seeks[i].exact) d.exact++;
+		frames += seeks[i].frames;
+	}
+	d.mean_frames = frames / (double)seeks.size();
+	fprintf(stderr, "%-10s min %8.2f  p50 %8.2f  p90 %8.2f  p99 %8.2f  max %8.2f ms  %7.1f frames/seek  %d/%d exact\n",
+		name, d.min, d.p50, d.p90, d.p99, d.max, d.mean_frames, d.exact, d.count);
+	return d;
+}
+
+static double s_ms_since(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char* argv[])
+{
+	const char* fn = nullptr;
+	int num_seeks = 200;
+	std::string json_path;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strncmp(argv[i], "--seeks=", 8) == 0)
+			num_seeks = atoi(argv[i] + 8);
+		else if (strncmp(argv[i], "--json=", 7) == 0)
+			json_path = argv[i] + 7;
+		else if (argv[i][0] != '-' && fn == nullptr)
+			fn = argv[i];
+	}
+	if (fn == nullptr || num_seeks < 1)
+	{
+		printf("usage: %s video_file [--seeks=n] [--json=file]\n", argv[0]);
+		return 1;
+	}
+
+	Media media;
+	if (!media.open(fn))
+	{
+		printf("Failed loading %s\n", fn);
+		return 1;
+	}
+
+	// every frame of the stream in presentation order, the ground truth for exactness
+	std::vector<int64_t> frames;
+	while (decode_to_frame(media.fmt_ctx, media.codec_ctx, media.stream_index, INT64_MIN, media.packet, media.frame))
+	{
+		frames.push_back(media.frame->best_effort_timestamp);
+		av_frame_unref(media.frame);
+	}
+	std::sort(frames.begin(), frames.end());
+	if (frames.size() == 0)
+	{
+		printf("No frames decoded from %s\n", fn);
+		return 1;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	KeyframeIndex index(fn, media.stream_index);
+	while (!index.is_ready())
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	double index_ms = s_ms_since(start);
+	fprintf(stderr, "%s: %zu frames, index built in %.1f ms\n", fn, frames.size(), index_ms);
+
+	std::mt19937 rng(1);
+	std::vector<int64_t> targets(num_seeks);
+	for (int i = 0; i < num_seeks; i++)
+		targets[i] = frames[rng() % frames.size()];
+
+	std::vector<Seek> legacy, indexed;
+	for (int i = 0; i < num_seeks; i++)
+	{
+		int64_t pos = media.to_micro_sec(targets[i]);
+
+		// the demuxer's search, then decoding until a packet's dts reaches the target
+		{
+			Seek seek;
+			seek.frames = 0;
+			int64_t got = AV_NOPTS_VALUE;
+			auto t0 = std::chrono::steady_clock::now();
+			avformat_seek_file(media.fmt_ctx, -1, INT64_MIN, pos, INT64_MAX, 0);
+			avcodec_flush_buffers(media.codec_ctx);
+			while (av_read_frame(media.fmt_ctx, media.packet) == 0)
+			{
+				if (media.packet->stream_index != media.stream_index)
+				{
+					av_packet_unref(media.packet);
+					continue;
+				}
+				int64_t t = media.to_micro_sec(media.packet->dts);
+				avcodec_send_packet(media.codec_ctx, media.packet);
+				if (avcodec_receive_frame(media.codec_ctx, media.frame) == 0)
+				{
+					seek.frames++;
+					got = media.frame->best_effort_timestamp;
+					av_frame_unref(media.frame);
+				}
+				av_packet_unref(media.packet);
+				if (t >= pos) break;
+			}
+			seek.ms = s_ms_since(t0);
+			seek.exact = got == targets[i];
+			legacy.push_back(seek);
+		}
+
+		// the last keyframe before the target, then decoding until a frame is shown at or after it
+		{
+			Seek seek;
+			seek.frames = 0;
+			int64_t got = AV_NOPTS_VALUE;
+			auto t0 = std::chrono::steady_clock::now();
+			index.seek(media.fmt_ctx, media.codec_ctx, media.to_pts(pos));
+			int frame_number = media.codec_ctx->frame_number;
+			if (decode_to_frame(media.fmt_ctx, media.codec_ctx, media.stream_index, media.to_pts(pos), media.packet, media.frame))
+			{
+				got = media.frame->best_effort_timestamp;
+				av_frame_unref(media.frame);
+			}
+			seek.ms = s_ms_since(t0);
+			seek.frames = media.codec_ctx->frame_number - frame_number;
+			seek.exact = got == targets[i];
+			indexed.push_back(seek);
+		}
+	}
+
+	std::vector<Distribution> results;
+	results.push_back(s_summarize("legacy", legacy));
+	results.push_back(s_summarize("indexed", indexed));
+
+	FILE* fp = stdout;
+	if (!json_path.empty())
+	{
+		fp = fopen(json_path.c_str(), "w");
+		if (fp == nullptr)
+		{
+			printf("Failed writing %s\n", json_path.c_str());
+			return 1;
+		}
+	}
+	fprintf(fp, "{\n  \"file\": \"%s\",\n  \"frames\": %zu,\n  \"index_ms\": %.3f,\n  \"seeks\": [\n", fn, frames.size(), index_ms);
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const Distribution& d = results[i];
+		fprintf(fp, "    { \"name\": \"%s\", \"count\": %d, \"exact\": %d, \"min_ms\": %.3f, \"p50_ms\": %.3f, \"p90_ms\": %.3f, \"p99_ms\": %.3f, \"max_ms\": %.3f, \"frames_per_seek\": %.2f }%s\n",
+			d.name.c_str(), d.count, d.exact, d.min, d.p50, d.p90, d.p99, d.max, d.mean_frames, i + 1 < results.size() ? "," : "");
+	}
+	fprintf(fp, "  ]\n}\n");
+	if (fp != stdout) fclose(fp);
+	return 0;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#ifdef _WIN32
+#include <Windows.h>
+#elif defined(__linux__)
+#include <climits>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <thread>
+#include <chrono>
+#endif
+
+namespace LiveKit
+{
+	static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "atomic_wait needs a plain 32-bit word");
+
+	// Blocks while '*addr' holds 'expected'. May return spuriously, callers re-check their condition.
+	inline void atomic_wait(std::atomic<uint32_t>* addr, uint32_t expected)
+	{
+#ifdef _WIN32
+		WaitOnAddress((volatile VOID*)addr, &expected, sizeof(uint32_t), INFINITE);
+#elif defined(__linux__)
+		syscall(SYS_futex, (uint32_t*)addr, FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+#else
+		if (addr->load() == expected)
+			std::this_thread::sleep_for(std::chrono::microseconds(200));
+#endif
+	}
+
+	// Wakes every thread blocked in atomic_wait() on 'addr'
+	inline void atomic_notify_all(std::atomic<uint32_t>* addr)
+	{
+#ifdef _WIN32
+		WakeByAddressAll((PVOID)addr);
+#elif defined(__linux__)
+		syscall(SYS_futex, (uint32_t*)addr, FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+#endif
+	}
+
+}
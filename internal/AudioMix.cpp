@@ -0,0 +1,50 @@
+#include "AudioMix.h"
+
+namespace LiveKit
+{
+	void s16_to_float_ring(const short* in, float* ring, size_t ring_len, size_t pos, size_t size)
+	{
+		for (size_t i = 0; i < size; i++)
+		{
+			size_t j = (pos + i) % ring_len;
+			ring[j * 2] = (float)in[i * 2] / 32768.0f;
+			ring[j * 2 + 1] = (float)in[i * 2 + 1] / 32768.0f;
+		}
+	}
+
+	void mix_resampled(const float* ring, size_t ring_len, double pos, double delta, float volume, float* buf, size_t size)
+	{
+		for (size_t i = 0; i < size; i++)
+		{
+			double p = pos + (double)i*delta;
+			size_t i_p = (size_t)p;
+			double frac_p = p - (double)i_p;
+			size_t p1 = i_p % ring_len;
+			size_t p2 = (i_p + 1) % ring_len;
+			{
+				float f1 = ring[p1 * 2];
+				float f2 = ring[p2 * 2];
+				buf[i * 2] += (f1 * (1.0f - frac_p) + f2 * frac_p)*volume;
+			}
+			{
+				float f1 = ring[p1 * 2 + 1];
+				float f2 = ring[p2 * 2 + 1];
+				buf[i * 2 + 1] += (f1 * (1.0f - frac_p) + f2 * frac_p)*volume;
+			}
+		}
+	}
+
+	static inline short round_clamp(float v)
+	{
+		v = v * 32768.0f + 0.5f;
+		if (v < -32767.0f) v = -32767.0f;
+		else if (v > 32767.0f) v = 32767.0f;
+		return (short)v;
+	}
+
+	void float_to_s16(const float* in, short* out, size_t size)
+	{
+		for (size_t i = 0; i < size * 2; i++)
+			out[i] = round_clamp(in[i]);
+	}
+}
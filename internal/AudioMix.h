@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+
+namespace LiveKit
+{
+	// Interleaved stereo sample kernels used by AudioPort.
+
+	// converts 'size' frames of s16 to float and stores them in a ring of 'ring_len' frames, starting at frame 'pos'
+	void s16_to_float_ring(const short* in, float* ring, size_t ring_len, size_t pos, size_t size);
+
+	// adds 'size' frames read from a ring of 'ring_len' frames to 'buf', starting at fractional frame 'pos'
+	// and advancing by 'delta' per frame with linear interpolation, scaled by 'volume'
+	void mix_resampled(const float* ring, size_t ring_len, double pos, double delta, float volume, float* buf, size_t size);
+
+	// converts 'size' frames of float to s16, rounding and clamping to [-32767, 32767]
+	void float_to_s16(const float* in, short* out, size_t size);
+}
@@ -1,4 +1,6 @@
 #include "AudioPort.h"
+#include "AudioMix.h"
+#include "FramePacer.h"
 #include "Utils.h"
 #include <vector>
 #include <thread>
@@ -56,25 +58,7 @@ namespace LiveKit
 		{
 			double pos = t_read * (double)m_samplerate;
 			double delta = (double)m_samplerate / (double)samplerate;
-
-			for (size_t i = 0; i < size; i++)
-			{
-				double p = pos + (double)i*delta;
-				size_t i_p = (size_t)p;
-				double frac_p = p - (double)i_p;
-				size_t p1 = i_p % (m_loop_queue.size() / 2);
-				size_t p2 = (i_p + 1) % (m_loop_queue.size() / 2);
-				{
-					float f1 = m_loop_queue[p1 * 2];
-					float f2 = m_loop_queue[p2 * 2];
-					buf[i * 2] += (f1 * (1.0f - frac_p) + f2 * frac_p)*m_volume;
-				}
-				{
-					float f1 = m_loop_queue[p1 * 2 + 1];
-					float f2 = m_loop_queue[p2 * 2 + 1];
-					buf[i * 2 + 1] += (f1 * (1.0f - frac_p) + f2 * frac_p)*m_volume;
-				}
-			}
+			mix_resampled(m_loop_queue.data(), m_loop_queue.size() / 2, pos, delta, m_volume, buf, size);
 		}
 
 	private:
@@ -89,6 +73,7 @@ namespace LiveKit
 		void* m_user_ptr;
 		size_t m_last_buffer;
 
+		FramePacer m_pacer;
 		bool m_writing = false;
 		std::unique_ptr<std::thread> m_thread_write;
 
@@ -104,17 +89,7 @@ namespace LiveKit
 
 		void write_buf(size_t pos)
 		{
-			for (size_t i = 0; i < m_samples_per_buffer; i++)
-			{
-				short v1 = m_buf[i * 2];
-				short v2 = m_buf[i * 2 + 1];
-				float f1 = (float)v1 / 32768.0f;
-				float f2 = (float)v2 / 32768.0f;
-
-				size_t j = (pos + i) % (m_loop_queue.size() / 2);
-				m_loop_queue[j * 2] = f1;
-				m_loop_queue[j * 2 + 1] = f2;
-			}
+			s16_to_float_ring(m_buf.data(), m_loop_queue.data(), m_loop_queue.size() / 2, pos, m_samples_per_buffer);
 		}
 
 		static void thread_write(Writer* self)
@@ -124,9 +99,7 @@ namespace LiveKit
 			{
 				size_t i_buf = self->m_last_buffer + 1;
 				uint64_t t_buf = i_buf * self->m_samples_per_buffer * 1000000 / self->m_samplerate;
-				uint64_t t = self->rel_time_micro_sec();
-				if (t_buf > t)
-					std::this_thread::sleep_for(std::chrono::microseconds(t_buf - t));
+				self->m_pacer.wait_until(self->m_port->m_ref_t + t_buf);
 				if (eof) break;
 				eof = !self->m_callback(self->m_buf.data(), (size_t)self->m_samples_per_buffer, self->m_user_ptr);
 				self->write_buf(i_buf*self->m_samples_per_buffer);
@@ -183,6 +156,7 @@ namespace LiveKit
 		void* m_user_ptr;
 		size_t m_last_buffer;
 
+		FramePacer m_pacer;
 		bool m_reading = false;
 		std::unique_ptr<std::thread> m_thread_read;
 
@@ -196,21 +170,9 @@ namespace LiveKit
 			return (double)time_micro_sec() / 1000000.0;
 		}
 
-		static inline short round_clamp(float v)
-		{
-			v = v * 32768.0f + 0.5f;
-			if (v < -32767.0f) v = -32767.0f;
-			else if (v > 32767.0f) v = 32767.0f;
-			return (short)v;
-		}
-
 		void convert_buf()
 		{
-			for (size_t i = 0; i < m_samples_per_buffer; i++)
-			{
-				m_buf[i * 2] = round_clamp(m_fbuf[i * 2]);
-				m_buf[i * 2 + 1] = round_clamp(m_fbuf[i * 2 + 1]);
-			}
+			float_to_s16(m_fbuf.data(), m_buf.data(), m_samples_per_buffer);
 		}
 
 		static void thread_read(Reader* self)
@@ -220,9 +182,7 @@ namespace LiveKit
 			{
 				size_t i_buf = self->m_last_buffer + 1;
 				uint64_t t_buf = i_buf * self->m_samples_per_buffer * 1000000 / self->m_samplerate;
-				uint64_t t = self->rel_time_micro_sec();
-				if (t_buf > t)
-					std::this_thread::sleep_for(std::chrono::microseconds(t_buf - t));
+				self->m_pacer.wait_until(self->m_port->m_ref_t + t_buf);
 
 				if (eof) break;
 
@@ -2,7 +2,8 @@
 
 #include "AudioBuffer.h"
 #include <queue>
-#include <Windows.h>
+#include <mutex>
+#include <condition_variable>
 
 namespace LiveKit
 {
@@ -11,8 +12,7 @@ namespace LiveKit
 	public:
 		BufferQueue()
 		{
-			InitializeCriticalSectionAndSpinCount(&m_cs, 0x00000400);
-			m_hSemaphore = CreateSemaphore(NULL, 0, ~(1 << 31), NULL);
+
 		}
 
 		~BufferQueue()
@@ -22,8 +22,6 @@ namespace LiveKit
 				AudioBuffer* buf = PopBuffer();
 				delete buf;
 			}
-			CloseHandle(m_hSemaphore);
-			DeleteCriticalSection(&m_cs);
 		}
 
 		size_t Size()
@@ -33,26 +31,26 @@ namespace LiveKit
 
 		void PushBuffer(AudioBuffer* buf)
 		{
-			EnterCriticalSection(&m_cs);
-			m_queue.push(buf);
-			LeaveCriticalSection(&m_cs);
-			ReleaseSemaphore(m_hSemaphore, 1, NULL);
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_queue.push(buf);
+			}
+			m_cond.notify_one();
 		}
 
 		AudioBuffer* PopBuffer()
 		{
-			WaitForSingleObject(m_hSemaphore, INFINITE);
-			EnterCriticalSection(&m_cs);
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_cond.wait(lock, [this]() { return m_queue.size() > 0; });
 			AudioBuffer* ret = m_queue.front();
 			m_queue.pop();
-			LeaveCriticalSection(&m_cs);
 			return ret;
 		}
 
 	private:
 		std::queue<AudioBuffer*> m_queue;
-		CRITICAL_SECTION m_cs;
-		HANDLE m_hSemaphore;
+		std::mutex m_mutex;
+		std::condition_variable m_cond;
 	};
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,73 @@
+#include "Decoder.h"
+#include <cstdio>
+#include <vector>
+
+namespace LiveKit
+{
+	AVDiscard to_av_discard(DecoderSkip skip)
+	{
+		switch (skip)
+		{
+		case DecoderSkip::NonRef:
+			return AVDISCARD_NONREF;
+		case DecoderSkip::Bidir:
+			return AVDISCARD_BIDIR;
+		case DecoderSkip::NonIntra:
+			return AVDISCARD_NONINTRA;
+		case DecoderSkip::NonKey:
+			return AVDISCARD_NONKEY;
+		case DecoderSkip::All:
+			return AVDISCARD_ALL;
+		default:
+			return AVDISCARD_DEFAULT;
+		}
+	}
+
+	static void s_set_threading(AVDictionary** dict, const DecoderOptions& options)
+	{
+		av_dict_set_int(dict, "threads", options.thread_count, 0);
+		if (options.thread_type == DecoderThreading::Frame)
+			av_dict_set(dict, "thread_type", "frame", 0);
+		else if (options.thread_type == DecoderThreading::Slice)
+			av_dict_set(dict, "thread_type", "slice", 0);
+		if (options.low_delay)
+			av_dict_set(dict, "flags", "+low_delay", 0);
+		for (size_t i = 0; i < options.extra.size(); i++)
+			av_dict_set(dict, options.extra[i].first.c_str(), options.extra[i].second.c_str(), 0);
+	}
+
+	AVCodecContext* open_decoder(const AVCodecParameters* codec_par, const DecoderOptions& options)
+	{
+		AVCodec* p_codec = avcodec_find_decoder(codec_par->codec_id);
+		if (p_codec == nullptr) return nullptr;
+		AVCodecContext* p_codec_ctx = avcodec_alloc_context3(p_codec);
+		avcodec_parameters_to_context(p_codec_ctx, codec_par);
+		p_codec_ctx->skip_frame = to_av_discard(options.skip_frame);
+		p_codec_ctx->skip_loop_filter = to_av_discard(options.skip_loop_filter);
+		p_codec_ctx->skip_idct = to_av_discard(options.skip_idct);
+
+		AVDictionary* dict = nullptr;
+		s_set_threading(&dict, options);
+		avcodec_open2(p_codec_ctx, p_codec, &dict);
+
+		// what is left was not recognized by the codec
+		AVDictionaryEntry* entry = nullptr;
+		while ((entry = av_dict_get(dict, "", entry, AV_DICT_IGNORE_SUFFIX)) != nullptr)
+			printf("Unknown decoder option %s\n", entry->key);
+		av_dict_free(&dict);
+		return p_codec_ctx;
+	}
+
+	int find_stream_info(AVFormatContext* fmt_ctx, const DecoderOptions& options)
+	{
+		// probing only needs a frame or two, so the skip options are left out: they could prevent it from
+		// decoding any
+		std::vector<AVDictionary*> dicts(fmt_ctx->nb_streams, nullptr);
+		for (size_t i = 0; i < dicts.size(); i++)
+			s_set_threading(&dicts[i], options);
+		int ret = avformat_find_stream_info(fmt_ctx, dicts.size() > 0 ? dicts.data() : nullptr);
+		for (size_t i = 0; i < dicts.size(); i++)
+			av_dict_free(&dicts[i]);
+		return ret;
+	}
+}
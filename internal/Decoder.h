@@ -0,0 +1,20 @@
+#pragma once
+
+#include "DecoderOptions.h"
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+}
+
+namespace LiveKit
+{
+	AVDiscard to_av_discard(DecoderSkip skip);
+
+	// nullptr if there is no decoder for the stream
+	AVCodecContext* open_decoder(const AVCodecParameters* codec_par, const DecoderOptions& options);
+
+	// avformat_find_stream_info() with the threading options and extra options applied to the
+	// decoders used for probing
+	int find_stream_info(AVFormatContext* fmt_ctx, const DecoderOptions& options);
+}
@@ -0,0 +1,82 @@
+#include "FramePacer.h"
+#include "Utils.h"
+#include <thread>
+
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+
+namespace LiveKit
+{
+	FramePacer::FramePacer(uint64_t late_tolerance)
+		: m_late_tolerance(late_tolerance), m_deadlines(0), m_missed(0), m_max_lateness(0), m_total_lateness(0)
+	{
+#ifdef _WIN32
+		// the default timer resolution makes sleeps overshoot by up to 15.6ms
+		timeBeginPeriod(1);
+#endif
+	}
+
+	FramePacer::~FramePacer()
+	{
+#ifdef _WIN32
+		timeEndPeriod(1);
+#endif
+	}
+
+	bool FramePacer::wait_until(uint64_t deadline)
+	{
+		uint64_t now = time_micro_sec();
+		if (now + s_spin_time < deadline)
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			uint64_t interrupts = m_interrupts;
+			m_cond.wait_for(lock, std::chrono::microseconds(deadline - s_spin_time - now), [this, interrupts]() { return m_interrupts != interrupts; });
+			if (m_interrupts != interrupts) return true;
+			now = time_micro_sec();
+		}
+		while (now < deadline)
+		{
+			std::this_thread::yield();
+			now = time_micro_sec();
+		}
+
+		uint64_t lateness = now - deadline;
+		m_deadlines++;
+		m_total_lateness += lateness;
+		if (lateness > m_max_lateness) m_max_lateness = lateness;
+		if (lateness > m_late_tolerance)
+		{
+			m_missed++;
+			return false;
+		}
+		return true;
+	}
+
+	void FramePacer::interrupt()
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_interrupts++;
+		}
+		m_cond.notify_all();
+	}
+
+	PacingStats FramePacer::get_stats() const
+	{
+		PacingStats stats;
+		stats.deadlines = m_deadlines;
+		stats.missed = m_missed;
+		stats.max_lateness = m_max_lateness;
+		stats.total_lateness = m_total_lateness;
+		return stats;
+	}
+
+	void FramePacer::reset_stats()
+	{
+		m_deadlines = 0;
+		m_missed = 0;
+		m_max_lateness = 0;
+		m_total_lateness = 0;
+	}
+}
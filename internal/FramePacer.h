@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+namespace LiveKit
+{
+	struct PacingStats
+	{
+		uint64_t deadlines = 0;
+		uint64_t missed = 0; // woke up later than the tolerance after the deadline
+		uint64_t max_lateness = 0; // microseconds
+		uint64_t total_lateness = 0; // microseconds
+	};
+
+	// Waits for absolute deadlines on the clock of time_micro_sec(). It sleeps until shortly before
+	// the deadline and spins the remainder, so that wake-up does not depend on the scheduler tick.
+	class FramePacer
+	{
+	public:
+		FramePacer(uint64_t late_tolerance = 1000);
+		~FramePacer();
+
+		// returns false if the deadline was missed, returns immediately if it has already passed
+		bool wait_until(uint64_t deadline);
+
+		// makes a wait in progress return early, without counting its deadline
+		void interrupt();
+
+		PacingStats get_stats() const;
+		void reset_stats();
+
+		// sleeping is stopped this long before a deadline, in microseconds
+		static const uint64_t s_spin_time = 2000;
+
+	private:
+		uint64_t m_late_tolerance;
+
+		std::mutex m_mutex;
+		std::condition_variable m_cond;
+		uint64_t m_interrupts = 0;
+
+		std::atomic<uint64_t> m_deadlines;
+		std::atomic<uint64_t> m_missed;
+		std::atomic<uint64_t> m_max_lateness;
+		std::atomic<uint64_t> m_total_lateness;
+	};
+
+}
@@ -1,4 +1,7 @@
 #include "Image.h"
+#include "ImagePool.h"
+#include "Decoder.h"
+#include "SliceScaler.h"
 #include "Utils.h"
 
 extern "C" {
@@ -12,24 +15,134 @@ extern "C" {
 
 namespace LiveKit
 {
-	Image::Image(int width, int height, bool has_alpha)
+	int Image::s_pixel_size(PixelFormat format)
+	{
+		switch (format)
+		{
+		case PixelFormat::BGR24:
+			return 3;
+		case PixelFormat::BGRA:
+		case PixelFormat::BGRX:
+			return 4;
+		case PixelFormat::P010:
+			return 2;
+		default:
+			return 1;
+		}
+	}
+
+	int Image::s_default_stride(int width, PixelFormat format, int alignment)
 	{
-		m_has_alpha = has_alpha;
+		// pad to whole pixels, so that the stride can also be expressed in pixels (GL_UNPACK_ROW_LENGTH)
+		int pixel_size = s_pixel_size(format);
+		int a = alignment;
+		int b = pixel_size;
+		while (b != 0)
+		{
+			int t = a % b;
+			a = b;
+			b = t;
+		}
+		int align_pixels = alignment / a;
+		return (width + align_pixels - 1) / align_pixels * align_pixels * pixel_size;
+	}
+
+	inline size_t s_layout(int height, PixelFormat format, int stride, int strides[3], size_t offsets[3])
+	{
+		int chroma_height = (height + 1) / 2;
+		strides[0] = stride;
+		offsets[0] = 0;
+		size_t luma_size = (size_t)stride * height;
+		switch (format)
+		{
+		case PixelFormat::I420:
+			strides[1] = strides[2] = (stride + 1) / 2;
+			offsets[1] = luma_size;
+			offsets[2] = luma_size + (size_t)strides[1] * chroma_height;
+			return offsets[2] + (size_t)strides[2] * chroma_height;
+		case PixelFormat::NV12:
+			strides[1] = (stride + 1) / 2 * 2;
+			strides[2] = 0;
+			offsets[1] = offsets[2] = luma_size;
+			return luma_size + (size_t)strides[1] * chroma_height;
+		case PixelFormat::P010:
+			strides[1] = (stride / 2 + 1) / 2 * 4;
+			strides[2] = 0;
+			offsets[1] = offsets[2] = luma_size;
+			return luma_size + (size_t)strides[1] * chroma_height;
+		default:
+			strides[1] = strides[2] = 0;
+			offsets[1] = offsets[2] = 0;
+			return luma_size;
+		}
+	}
+
+	size_t Image::s_buffer_size(int width, int height, PixelFormat format, int stride)
+	{
+		int strides[3];
+		size_t offsets[3];
+		return s_layout(height, format, stride, strides, offsets);
+	}
+
+	void Image::_init(int width, int height, PixelFormat format, int stride)
+	{
+		m_format = format;
 		m_width = width;
 		m_height = height;
-		AVPixelFormat out_pix_fmt = m_has_alpha ? AV_PIX_FMT_BGRA : AV_PIX_FMT_BGR24;
-		int buf_size = av_image_get_buffer_size(out_pix_fmt, m_width, m_height, 1);
-		m_buffer = (uint8_t *)av_malloc(buf_size);
+		s_layout(m_height, m_format, stride, m_strides, m_offsets);
+		m_buffer = ImagePool::s_get_instance().acquire(m_width, m_height, m_format, m_strides[0]);
+	}
+
+	Image::Image(int width, int height, bool has_alpha)
+	{
+		PixelFormat format = has_alpha ? PixelFormat::BGRA : PixelFormat::BGR24;
+		_init(width, height, format, s_default_stride(width, format));
 	}
 
-	Image::Image(const char* fn, bool keep_alpha)
+	Image::Image(int width, int height, PixelFormat format, int alignment)
+	{
+		_init(width, height, format, s_default_stride(width, format, alignment));
+	}
+
+	int Image::num_planes() const
+	{
+		switch (m_format)
+		{
+		case PixelFormat::I420:
+			return 3;
+		case PixelFormat::NV12:
+		case PixelFormat::P010:
+			return 2;
+		default:
+			return 1;
+		}
+	}
+
+	int Image::row_size(int plane) const
+	{
+		if (plane == 0) return m_width * pixel_size();
+		int chroma_width = (m_width + 1) / 2;
+		switch (m_format)
+		{
+		case PixelFormat::I420:
+			return chroma_width;
+		case PixelFormat::NV12:
+			return chroma_width * 2;
+		case PixelFormat::P010:
+			return chroma_width * 4;
+		default:
+			return 0;
+		}
+	}
+
+	Image::Image(const char* fn, bool keep_alpha, const DecoderOptions& decoder_options)
 	{
 		if (!exists_test(fn))
 			printf("Failed loading %s\n", fn);
 
 		AVFormatContext* p_fmt_ctx = nullptr;
 		avformat_open_input(&p_fmt_ctx, fn, nullptr, nullptr);
-		avformat_find_stream_info(p_fmt_ctx, nullptr);
+		find_stream_info(p_fmt_ctx, decoder_options);
 
 		int v_idx = -1;
 		int frame_rate;
@@ -43,26 +156,19 @@ namespace LiveKit
 			}
 		}
 
-		AVCodecParameters* p_codec_par = p_fmt_ctx->streams[v_idx]->codecpar;
-		AVCodec* p_codec = avcodec_find_decoder(p_codec_par->codec_id);
-		AVCodecContext* p_codec_ctx = avcodec_alloc_context3(p_codec);
-		avcodec_parameters_to_context(p_codec_ctx, p_codec_par);
-		avcodec_open2(p_codec_ctx, p_codec, NULL);
+		AVCodecContext* p_codec_ctx = open_decoder(p_fmt_ctx->streams[v_idx]->codecpar, decoder_options);
 
 		const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(p_codec_ctx->pix_fmt);
-		m_has_alpha = keep_alpha && (desc->flags& AV_PIX_FMT_FLAG_ALPHA != 0);
-		m_width = p_codec_ctx->width;
-		m_height = p_codec_ctx->height;
-		AVPixelFormat out_pix_fmt = m_has_alpha ? AV_PIX_FMT_BGRA : AV_PIX_FMT_BGR24;
+		bool has_alpha = keep_alpha && (desc->flags& AV_PIX_FMT_FLAG_ALPHA != 0);
+		PixelFormat format = has_alpha ? PixelFormat::BGRA : PixelFormat::BGRX;
+		_init(p_codec_ctx->width, p_codec_ctx->height, format, s_default_stride(p_codec_ctx->width, format));
+		AVPixelFormat out_pix_fmt = has_alpha ? AV_PIX_FMT_BGRA : AV_PIX_FMT_BGR0;
 
 		AVFrame* p_frm_raw = av_frame_alloc();
 		AVFrame* p_frm_bgr = av_frame_alloc();
 
-		int buf_size = av_image_get_buffer_size(out_pix_fmt, m_width, m_height, 1);
-		m_buffer = (uint8_t *)av_malloc(buf_size);
-
-		av_image_fill_arrays(p_frm_bgr->data, p_frm_bgr->linesize, m_buffer, out_pix_fmt, m_width, m_height, 1);
-		SwsContext* sws_ctx = sws_getContext(m_width, m_height, p_codec_ctx->pix_fmt, m_width, m_height, out_pix_fmt, SWS_BICUBIC, NULL, NULL, NULL);
+		p_frm_bgr->data[0] = m_buffer;
+		p_frm_bgr->linesize[0] = m_strides[0];
 
 		AVPacket packet;
 		while (true)
@@ -79,9 +185,9 @@ namespace LiveKit
 		avcodec_receive_frame(p_codec_ctx, p_frm_raw);
 		av_packet_unref(&packet);
 
-		sws_scale(sws_ctx, (const uint8_t *const *)p_frm_raw->data, p_frm_raw->linesize, 0, p_codec_ctx->height, p_frm_bgr->data, p_frm_bgr->linesize);
+		SliceScaler scaler(SWS_BICUBIC);
+		scaler.scale(p_frm_raw->data, p_frm_raw->linesize, m_width, m_height, p_codec_ctx->pix_fmt, p_frm_bgr->data, p_frm_bgr->linesize, m_width, m_height, out_pix_fmt);
 
-		sws_freeContext(sws_ctx);	
 		av_frame_free(&p_frm_bgr);
 		av_frame_free(&p_frm_raw);
 		avcodec_free_context(&p_codec_ctx);
@@ -91,19 +197,14 @@ namespace LiveKit
 
 	Image::Image(const Image& in)
 	{
-		m_has_alpha = in.m_has_alpha;
-		m_width = in.m_width;
-		m_height = in.m_height;
-		AVPixelFormat out_pix_fmt = m_has_alpha ? AV_PIX_FMT_BGRA : AV_PIX_FMT_BGR24;
-		int buf_size = av_image_get_buffer_size(out_pix_fmt, m_width, m_height, 1);
-		m_buffer = (uint8_t *)av_malloc(buf_size);
-		memcpy(m_buffer, in.m_buffer, buf_size);
+		_init(in.m_width, in.m_height, in.m_format, in.m_strides[0]);
+		memcpy(m_buffer, in.m_buffer, _buffer_size());
 		m_flipped = in.m_flipped;
 	}
 
 	Image::~Image()
 	{
-		av_free(m_buffer);
+		ImagePool::s_get_instance().release(m_buffer, m_width, m_height, m_format, m_strides[0]);
 	}
 
 	const uint8_t* Image::get_data(int& width, int& height) const
@@ -113,11 +214,27 @@ namespace LiveKit
 		return m_buffer;
 	}
 
+	void Image::_copy_from(const Image& in)
+	{
+		if (in.m_strides[0] == m_strides[0])
+		{
+			memcpy(m_buffer, in.m_buffer, _buffer_size());
+			return;
+		}
+
+		for (int i = 0; i < num_planes(); i++)
+		{
+			const uint8_t* p_in = in.data(i);
+			uint8_t* p_out = data(i);
+			int size = row_size(i);
+			for (int y = 0; y < plane_height(i); y++, p_in += in.m_strides[i], p_out += m_strides[i])
+				memcpy(p_out, p_in, size);
+		}
+	}
+
 	const Image& Image::operator=(const Image& in)
 	{
-		AVPixelFormat out_pix_fmt = m_has_alpha ? AV_PIX_FMT_BGRA : AV_PIX_FMT_BGR24;
-		int buf_size = av_image_get_buffer_size(out_pix_fmt, m_width, m_height, 1);
-		memcpy(m_buffer, in.m_buffer, buf_size);
+		_copy_from(in);
 		m_flipped = in.m_flipped;
 		return *this;
 	}
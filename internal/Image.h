@@ -1,21 +1,43 @@
 #pragma once
+#include "DecoderOptions.h"
 #include <cstdint>
+#include <cstddef>
 
 namespace LiveKit
 {
+	enum class PixelFormat
+	{
+		BGR24,
+		BGRA,
+		BGRX, // 4 bytes per pixel like BGRA, the 4th byte is unused
+		I420, // planar Y, U, V with 2x2 subsampled chroma
+		NV12, // planar Y, interleaved UV with 2x2 subsampled chroma
+		P010  // like NV12 with 16-bit little-endian samples, 10 significant bits in the high bits
+	};
+
 	class Image
 	{
 	public:
 		Image(int width, int height, bool has_alpha = false);
-		Image(const char* fn, bool keep_alpha = false);
+		// rows start at multiples of 'alignment' bytes, 1 packs them tightly
+		Image(int width, int height, PixelFormat format, int alignment = s_default_alignment);
+		Image(const char* fn, bool keep_alpha = false, const DecoderOptions& decoder_options = DecoderOptions());
 		Image(const Image& in);
 		~Image();
 
-		bool has_alpha() const { return m_has_alpha; }
+		PixelFormat format() const { return m_format; }
+		bool is_planar() const { return s_is_planar(m_format); }
+		bool has_alpha() const { return m_format == PixelFormat::BGRA; }
 		int width() const { return m_width; }
 		int height() const { return m_height; }
-		const uint8_t* data() const { return m_buffer; }
-		uint8_t* data() { return m_buffer; }
+
+		int num_planes() const;
+		int pixel_size() const { return s_pixel_size(m_format); } // bytes per pixel of plane 0
+		int stride(int plane = 0) const { return m_strides[plane]; }
+		int row_size(int plane = 0) const; // bytes of pixel data in a row, without the padding up to stride()
+		int plane_height(int plane = 0) const { return plane == 0 ? m_height : (m_height + 1) / 2; }
+		const uint8_t* data(int plane = 0) const { return m_buffer + m_offsets[plane]; }
+		uint8_t* data(int plane = 0) { return m_buffer + m_offsets[plane]; }
 
 		const uint8_t* get_data(int& width, int& height) const;
 
@@ -31,9 +53,21 @@ namespace LiveKit
 			return m_flipped;
 		}
 
+		static const int s_default_alignment = 32;
+		static int s_pixel_size(PixelFormat format);
+		static bool s_is_planar(PixelFormat format) { return format == PixelFormat::I420 || format == PixelFormat::NV12 || format == PixelFormat::P010; }
+		static int s_default_stride(int width, PixelFormat format, int alignment = s_default_alignment);
+		static size_t s_buffer_size(int width, int height, PixelFormat format, int stride);
+
 	private:
-		bool m_has_alpha;
+		void _init(int width, int height, PixelFormat format, int stride);
+		void _copy_from(const Image& in);
+		size_t _buffer_size() const { return s_buffer_size(m_width, m_height, m_format, m_strides[0]); }
+
+		PixelFormat m_format;
 		int m_width, m_height;
+		int m_strides[3];
+		size_t m_offsets[3];
 		uint8_t* m_buffer;
 
 		bool m_flipped = false;
@@ -41,4 +75,4 @@ namespace LiveKit
 
 
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,123 @@
+#include "ImageConverter.h"
+
+extern "C" {
+#include <libavutil/frame.h>
+#include <libavutil/imgutils.h>
+#include <libswscale/swscale.h>
+}
+
+namespace LiveKit
+{
+	inline void s_get_planes(const Image* image, uint8_t* data[4], int linesize[4])
+	{
+		int num_planes = image->num_planes();
+		for (int i = 0; i < 4; i++)
+		{
+			if (i < num_planes)
+			{
+				data[i] = (uint8_t*)image->data(i);
+				linesize[i] = image->stride(i);
+			}
+			else
+			{
+				data[i] = nullptr;
+				linesize[i] = 0;
+			}
+		}
+	}
+
+	ImageConverter::ImageConverter()
+		: m_scaler(new SliceScaler(SWS_BICUBIC))
+	{
+
+	}
+
+	ImageConverter::~ImageConverter()
+	{
+
+	}
+
+	PixelFormat ImageConverter::s_native_format(int av_pix_fmt, PixelFormat fallback)
+	{
+		// full-range YUVJ formats are left to swscale so the range is handled on conversion
+		switch (av_pix_fmt)
+		{
+		case AV_PIX_FMT_YUV420P:
+			return PixelFormat::I420;
+		case AV_PIX_FMT_NV12:
+			return PixelFormat::NV12;
+		case AV_PIX_FMT_P010LE:
+			return PixelFormat::P010;
+		case AV_PIX_FMT_BGR24:
+			return PixelFormat::BGR24;
+		case AV_PIX_FMT_BGRA:
+			return PixelFormat::BGRA;
+		case AV_PIX_FMT_BGR0:
+			return PixelFormat::BGRX;
+		default:
+			return fallback;
+		}
+	}
+
+	int ImageConverter::s_av_pix_fmt(PixelFormat format)
+	{
+		switch (format)
+		{
+		case PixelFormat::BGRA:
+			return AV_PIX_FMT_BGRA;
+		case PixelFormat::BGRX:
+			return AV_PIX_FMT_BGR0;
+		case PixelFormat::I420:
+			return AV_PIX_FMT_YUV420P;
+		case PixelFormat::NV12:
+			return AV_PIX_FMT_NV12;
+		case PixelFormat::P010:
+			return AV_PIX_FMT_P010LE;
+		default:
+			return AV_PIX_FMT_BGR24;
+		}
+	}
+
+	void ImageConverter::frame_to_image(const AVFrame* frame, Image* image)
+	{
+		uint8_t* data[4];
+		int linesize[4];
+		s_get_planes(image, data, linesize);
+
+		int dst_fmt = s_av_pix_fmt(image->format());
+		if (frame->format == dst_fmt && frame->width == image->width() && frame->height == image->height())
+		{
+			av_image_copy(data, linesize, (const uint8_t **)frame->data, frame->linesize, (AVPixelFormat)dst_fmt, frame->width, frame->height);
+		}
+		else
+		{
+			m_scaler->scale(frame->data, frame->linesize, frame->width, frame->height, frame->format, data, linesize, image->width(), image->height(), dst_fmt);
+		}
+	}
+
+	const Image* ImageConverter::convert(const Image* in, PixelFormat format)
+	{
+		if (in->format() == format) return in;
+
+		if (m_out == nullptr || m_out->width() != in->width() || m_out->height() != in->height() || m_out->format() != format)
+			m_out = (std::unique_ptr<Image>)(new Image(in->width(), in->height(), format));
+
+		uint8_t* src_data[4];
+		int src_linesize[4];
+		s_get_planes(in, src_data, src_linesize);
+
+		uint8_t* dst_data[4];
+		int dst_linesize[4];
+		s_get_planes(m_out.get(), dst_data, dst_linesize);
+
+		m_scaler->scale(src_data, src_linesize, in->width(), in->height(), s_av_pix_fmt(in->format()), dst_data, dst_linesize, in->width(), in->height(), s_av_pix_fmt(format));
+		m_out->set_flipped(in->is_flipped());
+		return m_out.get();
+	}
+
+	const Image* ImageConverter::to_packed(const Image* in)
+	{
+		if (!in->is_planar()) return in;
+		return convert(in, PixelFormat::BGRX);
+	}
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "Image.h"
+#include "SliceScaler.h"
+#include <memory>
+
+struct AVFrame;
+
+namespace LiveKit
+{
+	// Pixel format conversion with cached swscale contexts, split into slices on the shared WorkerPool.
+	// Frames already in the requested format are passed through, so planar YUV is only converted by
+	// consumers that need BGR.
+	class ImageConverter
+	{
+	public:
+		ImageConverter();
+		~ImageConverter();
+
+		// AVPixelFormat values are passed as int to keep FFmpeg headers out of here
+		// decoder formats an Image can hold as-is map to themselves, everything else to 'fallback'
+		static PixelFormat s_native_format(int av_pix_fmt, PixelFormat fallback = PixelFormat::BGRX);
+		static int s_av_pix_fmt(PixelFormat format);
+
+		// copies the planes when 'image' has the frame's own format and size, converts and scales otherwise
+		void frame_to_image(const AVFrame* frame, Image* image);
+
+		// returns 'in' itself when it already has 'format', otherwise a converted image owned by the converter
+		const Image* convert(const Image* in, PixelFormat format);
+
+		// packed formats are returned as-is, planar formats are converted to BGRX
+		const Image* to_packed(const Image* in);
+
+	private:
+		std::unique_ptr<SliceScaler> m_scaler;
+		std::unique_ptr<Image> m_out;
+	};
+
+}
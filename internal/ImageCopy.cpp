@@ -0,0 +1,257 @@
+#include "ImageCopy.h"
+#include <cstring>
+#include <atomic>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define LIVEKIT_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define LIVEKIT_TARGET(isa)
+#else
+#define LIVEKIT_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
+
+namespace LiveKit
+{
+	static SimdLevel s_detect_simd_level()
+	{
+#if LIVEKIT_X86
+#ifdef _MSC_VER
+		int info[4];
+		__cpuid(info, 0);
+		int max_leaf = info[0];
+		__cpuid(info, 1);
+		bool sse4 = (info[2] & (1 << 19)) != 0;
+		bool avx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0; // osxsave + avx
+		bool avx2 = false;
+		if (avx && max_leaf >= 7 && (_xgetbv(0) & 6) == 6)
+		{
+			__cpuidex(info, 7, 0);
+			avx2 = (info[1] & (1 << 5)) != 0;
+		}
+#else
+		__builtin_cpu_init();
+		bool sse4 = __builtin_cpu_supports("sse4.1");
+		bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+		if (avx2) return SimdLevel::AVX2;
+		if (sse4) return SimdLevel::SSE4;
+#endif
+		return SimdLevel::Scalar;
+	}
+
+	SimdLevel max_simd_level()
+	{
+		static const SimdLevel s_level = s_detect_simd_level();
+		return s_level;
+	}
+
+	static std::atomic<int> s_simd_level((int)max_simd_level());
+
+	SimdLevel simd_level()
+	{
+		return (SimdLevel)s_simd_level.load(std::memory_order_relaxed);
+	}
+
+	void set_simd_level(SimdLevel level)
+	{
+		if ((int)level > (int)max_simd_level())
+			level = max_simd_level();
+		s_simd_level = (int)level;
+	}
+
+	static void s_row_3to4_scalar(const uint8_t* in, uint8_t* out, int width)
+	{
+		for (int x = 0; x < width; x++, in += 3, out += 4)
+		{
+			out[0] = in[0];
+			out[1] = in[1];
+			out[2] = in[2];
+			out[3] = 255;
+		}
+	}
+
+	static void s_row_4to3_scalar(const uint8_t* in, uint8_t* out, int width)
+	{
+		for (int x = 0; x < width; x++, in += 4, out += 3)
+		{
+			out[0] = in[0];
+			out[1] = in[1];
+			out[2] = in[2];
+		}
+	}
+
+#if LIVEKIT_X86
+	// The vector loops read or write 16/32 bytes per step while consuming fewer, so they stop
+	// early enough to stay inside the row and leave the rest to the scalar loop.
+
+	LIVEKIT_TARGET("sse4.1")
+	static void s_row_3to4_sse4(const uint8_t* in, uint8_t* out, int width)
+	{
+		const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+		const __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+		int x = 0;
+		for (; x + 6 <= width; x += 4)
+		{
+			__m128i v = _mm_loadu_si128((const __m128i*)(in + x * 3));
+			v = _mm_or_si128(_mm_shuffle_epi8(v, shuffle), alpha);
+			_mm_storeu_si128((__m128i*)(out + x * 4), v);
+		}
+		s_row_3to4_scalar(in + x * 3, out + x * 4, width - x);
+	}
+
+	LIVEKIT_TARGET("sse4.1")
+	static void s_row_4to3_sse4(const uint8_t* in, uint8_t* out, int width)
+	{
+		const __m128i shuffle = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+		int x = 0;
+		for (; x + 6 <= width; x += 4)
+		{
+			__m128i v = _mm_loadu_si128((const __m128i*)(in + x * 4));
+			_mm_storeu_si128((__m128i*)(out + x * 3), _mm_shuffle_epi8(v, shuffle));
+		}
+		s_row_4to3_scalar(in + x * 4, out + x * 3, width - x);
+	}
+
+	LIVEKIT_TARGET("avx2")
+	static void s_row_3to4_avx2(const uint8_t* in, uint8_t* out, int width)
+	{
+		const __m256i shuffle = _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+			0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+		const __m256i alpha = _mm256_set1_epi32((int)0xFF000000);
+		int x = 0;
+		for (; x + 10 <= width; x += 8)
+		{
+			const uint8_t* p = in + x * 3;
+			__m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)p)),
+				_mm_loadu_si128((const __m128i*)(p + 12)), 1);
+			v = _mm256_or_si256(_mm256_shuffle_epi8(v, shuffle), alpha);
+			_mm256_storeu_si256((__m256i*)(out + x * 4), v);
+		}
+		s_row_3to4_sse4(in + x * 3, out + x * 4, width - x);
+	}
+
+	LIVEKIT_TARGET("avx2")
+	static void s_row_4to3_avx2(const uint8_t* in, uint8_t* out, int width)
+	{
+		const __m256i shuffle = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+			0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+		const __m256i pack = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7);
+		int x = 0;
+		for (; x + 11 <= width; x += 8)
+		{
+			__m256i v = _mm256_loadu_si256((const __m256i*)(in + x * 4));
+			v = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(v, shuffle), pack);
+			_mm256_storeu_si256((__m256i*)(out + x * 3), v);
+		}
+		s_row_4to3_sse4(in + x * 4, out + x * 3, width - x);
+	}
+#endif
+
+	void convert_row_3to4(const uint8_t* in, uint8_t* out, int width)
+	{
+		switch (simd_level())
+		{
+#if LIVEKIT_X86
+		case SimdLevel::AVX2:
+			s_row_3to4_avx2(in, out, width);
+			return;
+		case SimdLevel::SSE4:
+			s_row_3to4_sse4(in, out, width);
+			return;
+#endif
+		default:
+			s_row_3to4_scalar(in, out, width);
+		}
+	}
+
+	void convert_row_4to3(const uint8_t* in, uint8_t* out, int width)
+	{
+		switch (simd_level())
+		{
+#if LIVEKIT_X86
+		case SimdLevel::AVX2:
+			s_row_4to3_avx2(in, out, width);
+			return;
+		case SimdLevel::SSE4:
+			s_row_4to3_sse4(in, out, width);
+			return;
+#endif
+		default:
+			s_row_4to3_scalar(in, out, width);
+		}
+	}
+
+	static void s_convert_row(const uint8_t* in, int chn_in, uint8_t* out, int chn_out, int width)
+	{
+		if (chn_in == chn_out)
+		{
+			memcpy(out, in, (size_t)width * chn_in);
+		}
+		else if (chn_in == 3 && chn_out == 4)
+		{
+			convert_row_3to4(in, out, width);
+		}
+		else if (chn_in == 4 && chn_out == 3)
+		{
+			convert_row_4to3(in, out, width);
+		}
+		else
+		{
+			for (int x = 0; x < width; x++, in += chn_in, out += chn_out)
+			{
+				int c = 0;
+				for (; c < chn_in && c < chn_out; c++)
+					out[c] = in[c];
+				for (; c < chn_out; c++)
+					out[c] = 255;
+			}
+		}
+	}
+
+	void copy_centered(const uint8_t* data_in, int width_in, int height_in, int chn_in, int stride_in,
+		uint8_t* data_out, int width_out, int height_out, int chn_out, int stride_out, bool flip)
+	{
+		int offset_in_x = 0;
+		int offset_in_y = 0;
+		int offset_out_x = 0;
+		int offset_out_y = 0;
+		int scan_w = width_out < width_in ? width_out : width_in;
+		int scan_h = height_out < height_in ? height_out : height_in;
+
+		if (width_in < width_out)
+			offset_out_x = (width_out - width_in) / 2;
+		else if (width_in > width_out)
+			offset_in_x = (width_in - width_out) / 2;
+
+		if (height_in < height_out)
+			offset_out_y = (height_out - height_in) / 2;
+		else if (height_in > height_out)
+			offset_in_y = (height_in - height_out) / 2;
+
+		// clear only the borders the input does not cover
+		size_t row_out = (size_t)width_out * chn_out;
+		for (int y = 0; y < offset_out_y; y++)
+			memset(data_out + (size_t)y * stride_out, 0, row_out);
+		for (int y = offset_out_y + scan_h; y < height_out; y++)
+			memset(data_out + (size_t)y * stride_out, 0, row_out);
+
+		size_t left = (size_t)offset_out_x * chn_out;
+		size_t right = row_out - left - (size_t)scan_w * chn_out;
+
+		for (int y = 0; y < scan_h; y++)
+		{
+			int y_in = flip ? (scan_h - 1) - y : y;
+			const uint8_t* p_in = data_in + (size_t)(y_in + offset_in_y) * stride_in + (size_t)offset_in_x * chn_in;
+			uint8_t* p_out_line = data_out + (size_t)(y + offset_out_y) * stride_out;
+
+			if (left > 0)
+				memset(p_out_line, 0, left);
+			s_convert_row(p_in, chn_in, p_out_line + left, chn_out, scan_w);
+			if (right > 0)
+				memset(p_out_line + row_out - right, 0, right);
+		}
+	}
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+
+namespace LiveKit
+{
+	enum class SimdLevel
+	{
+		Scalar,
+		SSE4,
+		AVX2
+	};
+
+	// best level supported by the CPU, and the level currently used by the kernels
+	SimdLevel max_simd_level();
+	SimdLevel simd_level();
+
+	// restricts the kernels to 'level' (clamped to what the CPU supports), for testing and benchmarking
+	void set_simd_level(SimdLevel level);
+
+	// per-row channel conversion, the 4th channel is set to 255 when added
+	void convert_row_3to4(const uint8_t* in, uint8_t* out, int width);
+	void convert_row_4to3(const uint8_t* in, uint8_t* out, int width);
+
+	// Copies the centered overlap of two packed images, padding with black or cropping as needed.
+	// Strides are in bytes. Only the part of 'data_out' not covered by the input is cleared.
+	void copy_centered(const uint8_t* data_in, int width_in, int height_in, int chn_in, int stride_in,
+		uint8_t* data_out, int width_out, int height_out, int chn_out, int stride_out, bool flip);
+
+}
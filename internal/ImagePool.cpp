@@ -0,0 +1,162 @@
+#include "ImagePool.h"
+
+extern "C" {
+#include <libavutil/mem.h>
+}
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+namespace LiveKit
+{
+	ImagePool& ImagePool::s_get_instance()
+	{
+		static ImagePool s_pool;
+		return s_pool;
+	}
+
+	ImagePool::ImagePool()
+	{
+
+	}
+
+	ImagePool::~ImagePool()
+	{
+		clear();
+	}
+
+	uint8_t* ImagePool::_alloc(size_t size)
+	{
+		if (m_huge_pages && size >= m_huge_threshold)
+		{
+#ifdef _WIN32
+			size_t page = GetLargePageMinimum();
+			if (page > 0)
+			{
+				size_t mapped_size = (size + page - 1) / page * page;
+				void* ptr = VirtualAlloc(nullptr, mapped_size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+				if (ptr != nullptr)
+				{
+					m_huge_buffers[(uint8_t*)ptr] = mapped_size;
+					return (uint8_t*)ptr;
+				}
+			}
+#else
+			size_t page = 2 * 1024 * 1024;
+			size_t mapped_size = (size + page - 1) / page * page;
+			void* ptr = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+			if (ptr == MAP_FAILED)
+			{
+				// no reserved huge pages, ask for transparent ones instead
+				ptr = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+				if (ptr != MAP_FAILED)
+					madvise(ptr, mapped_size, MADV_HUGEPAGE);
+			}
+			if (ptr != MAP_FAILED)
+			{
+				m_huge_buffers[(uint8_t*)ptr] = mapped_size;
+				return (uint8_t*)ptr;
+			}
+#endif
+		}
+		return (uint8_t*)av_malloc(size);
+	}
+
+	void ImagePool::_free(uint8_t* buffer)
+	{
+		auto iter = m_huge_buffers.find(buffer);
+		if (iter != m_huge_buffers.end())
+		{
+#ifdef _WIN32
+			VirtualFree(buffer, 0, MEM_RELEASE);
+#else
+			munmap(buffer, iter->second);
+#endif
+			m_huge_buffers.erase(iter);
+		}
+		else
+		{
+			av_free(buffer);
+		}
+	}
+
+	uint8_t* ImagePool::acquire(int width, int height, PixelFormat format, int stride)
+	{
+		Key key = { width, height, format, stride };
+		std::unique_lock<std::mutex> lock(m_mutex);
+		auto iter = m_idle.find(key);
+		if (iter != m_idle.end() && iter->second.size() > 0)
+		{
+			uint8_t* buffer = iter->second.back();
+			iter->second.pop_back();
+			m_idle_size -= s_buffer_size(key);
+			return buffer;
+		}
+		return _alloc(s_buffer_size(key));
+	}
+
+	void ImagePool::release(uint8_t* buffer, int width, int height, PixelFormat format, int stride)
+	{
+		if (buffer == nullptr) return;
+		Key key = { width, height, format, stride };
+		size_t size = s_buffer_size(key);
+		std::unique_lock<std::mutex> lock(m_mutex);
+		if (m_idle_size + size > m_capacity)
+		{
+			_free(buffer);
+			return;
+		}
+		m_idle[key].push_back(buffer);
+		m_idle_size += size;
+	}
+
+	void ImagePool::set_capacity(size_t capacity)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_capacity = capacity;
+		for (auto iter = m_idle.begin(); iter != m_idle.end() && m_idle_size > m_capacity; iter++)
+		{
+			size_t size = s_buffer_size(iter->first);
+			while (iter->second.size() > 0 && m_idle_size > m_capacity)
+			{
+				_free(iter->second.back());
+				iter->second.pop_back();
+				m_idle_size -= size;
+			}
+		}
+	}
+
+	size_t ImagePool::capacity() const
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		return m_capacity;
+	}
+
+	size_t ImagePool::idle_size() const
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		return m_idle_size;
+	}
+
+	void ImagePool::set_huge_pages(bool enable, size_t threshold)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_huge_pages = enable;
+		m_huge_threshold = threshold;
+	}
+
+	void ImagePool::clear()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		for (auto iter = m_idle.begin(); iter != m_idle.end(); iter++)
+		{
+			for (size_t i = 0; i < iter->second.size(); i++)
+				_free(iter->second[i]);
+		}
+		m_idle.clear();
+		m_idle_size = 0;
+	}
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "Image.h"
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace LiveKit
+{
+	// Process-wide cache of frame buffers, keyed by geometry. Image allocates from and returns to it,
+	// so producers whose frame size changes back and forth do not churn the allocator.
+	class ImagePool
+	{
+	public:
+		static ImagePool& s_get_instance();
+
+		uint8_t* acquire(int width, int height, PixelFormat format, int stride);
+		void release(uint8_t* buffer, int width, int height, PixelFormat format, int stride);
+
+		// maximum number of bytes kept by idle buffers, buffers released beyond it are freed
+		void set_capacity(size_t capacity);
+		size_t capacity() const;
+		size_t idle_size() const;
+
+		// buffers of at least 'threshold' bytes are backed by large pages when the system permits
+		void set_huge_pages(bool enable, size_t threshold = 8 * 1024 * 1024);
+
+		void clear();
+
+	private:
+		ImagePool();
+		~ImagePool();
+
+		struct Key
+		{
+			int width;
+			int height;
+			PixelFormat format;
+			int stride;
+			bool operator==(const Key& other) const
+			{
+				return width == other.width && height == other.height && format == other.format && stride == other.stride;
+			}
+		};
+
+		struct KeyHash
+		{
+			size_t operator()(const Key& key) const
+			{
+				size_t h = (size_t)key.width;
+				h = h * 31 + (size_t)key.height;
+				h = h * 31 + (size_t)key.format;
+				h = h * 31 + (size_t)key.stride;
+				return h;
+			}
+		};
+
+		static size_t s_buffer_size(const Key& key) { return Image::s_buffer_size(key.width, key.height, key.format, key.stride); }
+
+		uint8_t* _alloc(size_t size);
+		void _free(uint8_t* buffer);
+
+		mutable std::mutex m_mutex;
+		std::unordered_map<Key, std::vector<uint8_t*>, KeyHash> m_idle;
+		std::unordered_map<uint8_t*, size_t> m_huge_buffers;
+		size_t m_idle_size = 0;
+		size_t m_capacity = 256 * 1024 * 1024;
+		bool m_huge_pages = false;
+		size_t m_huge_threshold = 8 * 1024 * 1024;
+	};
+
+}
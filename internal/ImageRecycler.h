@@ -0,0 +1,48 @@
+#pragma once
+
+#include "Image.h"
+#include <memory>
+#include <vector>
+
+namespace LiveKit
+{
+	// Frame buffers owned by a single producer thread. A buffer is handed out again only after
+	// every target that kept a reference to it (see ImageRef) has dropped that reference.
+	class ImageRecycler
+	{
+	public:
+		ImageRecycler() {}
+		~ImageRecycler() {}
+
+		std::shared_ptr<Image> get(int width, int height, bool has_alpha = false)
+		{
+			return get(width, height, has_alpha ? PixelFormat::BGRA : PixelFormat::BGR24);
+		}
+
+		std::shared_ptr<Image> get(int width, int height, PixelFormat format)
+		{
+			for (size_t i = 0; i < m_images.size(); )
+			{
+				std::shared_ptr<Image>& img = m_images[i];
+				if (img.use_count() == 1)
+				{
+					if (img->width() == width && img->height() == height && img->format() == format)
+						return img;
+
+					// geometry changed, this buffer will never be used again
+					m_images.erase(m_images.begin() + i);
+					continue;
+				}
+				i++;
+			}
+
+			std::shared_ptr<Image> img(new Image(width, height, format));
+			m_images.push_back(img);
+			return img;
+		}
+
+	private:
+		std::vector<std::shared_ptr<Image>> m_images;
+	};
+
+}
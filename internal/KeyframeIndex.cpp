@@ -0,0 +1,207 @@
+#include "KeyframeIndex.h"
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+}
+
+#include <sys/stat.h>
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+namespace LiveKit
+{
+	static bool s_sidecar = false;
+
+	void KeyframeIndex::s_set_sidecar(bool enable)
+	{
+		s_sidecar = enable;
+	}
+
+	// identifies the media file a sidecar was written for
+	struct SidecarHeader
+	{
+		char magic[4];
+		uint32_t version;
+		uint64_t file_size;
+		int64_t file_time;
+		int32_t stream_index;
+		uint32_t count;
+	};
+
+	static const uint32_t s_sidecar_version = 1;
+
+	static bool s_file_stamp(const char* fn, uint64_t& size, int64_t& time)
+	{
+#ifdef _WIN32
+		struct _stat64 st;
+		if (_stat64(fn, &st) != 0) return false;
+#else
+		struct stat st;
+		if (stat(fn, &st) != 0) return false;
+#endif
+		size = (uint64_t)st.st_size;
+		time = (int64_t)st.st_mtime;
+		return true;
+	}
+
+	KeyframeIndex::KeyframeIndex(const char* fn, int stream_index) : m_fn(fn), m_stream_index(stream_index), m_ready(false), m_scanning(true)
+	{
+		m_thread_scan = (std::unique_ptr<std::thread>)(new std::thread(thread_scan, this));
+	}
+
+	KeyframeIndex::~KeyframeIndex()
+	{
+		m_scanning = false;
+		m_thread_scan->join();
+	}
+
+	const KeyframeIndex::Keyframe* KeyframeIndex::find(int64_t pts) const
+	{
+		if (!m_ready) return nullptr;
+		auto iter = std::upper_bound(m_keyframes.begin(), m_keyframes.end(), pts, [](int64_t t, const Keyframe& key) { return t < key.pts; });
+		if (iter == m_keyframes.begin()) return nullptr;
+		return &*(iter - 1);
+	}
+
+	void KeyframeIndex::seek(AVFormatContext* fmt_ctx, AVCodecContext* codec_ctx, int64_t pts) const
+	{
+		// demuxers search their own index by dts, which for the keyframe itself is at or before its pts
+		int64_t ts = pts;
+		const Keyframe* key = find(pts);
+		if (key != nullptr)
+			ts = key->dts != AV_NOPTS_VALUE ? key->dts : key->pts;
+
+		// nothing at or before the target, start from the beginning
+		if (avformat_seek_file(fmt_ctx, m_stream_index, INT64_MIN, ts, ts, 0) < 0)
+			avformat_seek_file(fmt_ctx, m_stream_index, INT64_MIN, ts, INT64_MAX, 0);
+
+		if (codec_ctx != nullptr)
+			avcodec_flush_buffers(codec_ctx);
+	}
+
+	bool KeyframeIndex::_scan()
+	{
+		AVFormatContext* p_fmt_ctx = nullptr;
+		if (avformat_open_input(&p_fmt_ctx, m_fn.c_str(), nullptr, nullptr) != 0) return false;
+		if (avformat_find_stream_info(p_fmt_ctx, nullptr) < 0 || m_stream_index >= (int)p_fmt_ctx->nb_streams)
+		{
+			avformat_close_input(&p_fmt_ctx);
+			return false;
+		}
+
+		// only packet headers are needed, and only of the one stream
+		for (unsigned i = 0; i < p_fmt_ctx->nb_streams; i++)
+		{
+			if ((int)i != m_stream_index)
+				p_fmt_ctx->streams[i]->discard = AVDISCARD_ALL;
+		}
+
+		AVPacket* packet = av_packet_alloc();
+		std::vector<Keyframe> keyframes;
+		while (m_scanning && av_read_frame(p_fmt_ctx, packet) == 0)
+		{
+			if (packet->stream_index == m_stream_index && (packet->flags & AV_PKT_FLAG_KEY) != 0)
+			{
+				Keyframe key;
+				key.dts = packet->dts;
+				key.pts = packet->pts != AV_NOPTS_VALUE ? packet->pts : packet->dts;
+				if (key.pts != AV_NOPTS_VALUE)
+					keyframes.push_back(key);
+			}
+			av_packet_unref(packet);
+		}
+		av_packet_free(&packet);
+		avformat_close_input(&p_fmt_ctx);
+		if (!m_scanning) return false;
+
+		std::sort(keyframes.begin(), keyframes.end(), [](const Keyframe& a, const Keyframe& b) { return a.pts < b.pts; });
+		m_keyframes = std::move(keyframes);
+		return true;
+	}
+
+	bool KeyframeIndex::_load(const std::string& path)
+	{
+		uint64_t file_size;
+		int64_t file_time;
+		if (!s_file_stamp(m_fn.c_str(), file_size, file_time)) return false;
+
+		FILE* fp = fopen(path.c_str(), "rb");
+		if (fp == nullptr) return false;
+
+		SidecarHeader header;
+		bool valid = fread(&header, sizeof(header), 1, fp) == 1 && memcmp(header.magic, "LKIX", 4) == 0 && header.version == s_sidecar_version
+			&& header.file_size == file_size && header.file_time == file_time && header.stream_index == m_stream_index;
+		if (valid)
+		{
+			std::vector<Keyframe> keyframes(header.count);
+			valid = header.count == 0 || fread(keyframes.data(), sizeof(Keyframe), header.count, fp) == header.count;
+			if (valid) m_keyframes = std::move(keyframes);
+		}
+		fclose(fp);
+		return valid;
+	}
+
+	void KeyframeIndex::_save(const std::string& path) const
+	{
+		SidecarHeader header;
+		memcpy(header.magic, "LKIX", 4);
+		header.version = s_sidecar_version;
+		header.stream_index = m_stream_index;
+		header.count = (uint32_t)m_keyframes.size();
+		if (!s_file_stamp(m_fn.c_str(), header.file_size, header.file_time)) return;
+
+		// the media may sit in a read-only location, the index is then rebuilt next time
+		FILE* fp = fopen(path.c_str(), "wb");
+		if (fp == nullptr) return;
+		fwrite(&header, sizeof(header), 1, fp);
+		fwrite(m_keyframes.data(), sizeof(Keyframe), m_keyframes.size(), fp);
+		fclose(fp);
+	}
+
+	void KeyframeIndex::thread_scan(KeyframeIndex* self)
+	{
+		std::string path = self->m_fn + ".lkidx";
+		bool sidecar = s_sidecar;
+		if (sidecar && self->_load(path))
+		{
+			self->m_ready = true;
+			return;
+		}
+
+		if (self->_scan())
+		{
+			if (sidecar) self->_save(path);
+			self->m_ready = true;
+		}
+	}
+
+	bool decode_to_frame(AVFormatContext* fmt_ctx, AVCodecContext* codec_ctx, int stream_index, int64_t pts, AVPacket* packet, AVFrame* frame)
+	{
+		while (true)
+		{
+			int ret = avcodec_receive_frame(codec_ctx, frame);
+			if (ret == 0)
+			{
+				// frames come out in presentation order, B-frames included
+				int64_t t = frame->best_effort_timestamp;
+				if (t == AV_NOPTS_VALUE || t >= pts) return true;
+				av_frame_unref(frame);
+				continue;
+			}
+			if (ret != AVERROR(EAGAIN)) return false;
+
+			if (av_read_frame(fmt_ctx, packet) != 0)
+			{
+				// end of stream, drain the frames the decoder is still holding back
+				avcodec_send_packet(codec_ctx, nullptr);
+				continue;
+			}
+			if (packet->stream_index == stream_index)
+				avcodec_send_packet(codec_ctx, packet);
+			av_packet_unref(packet);
+		}
+	}
+
+}
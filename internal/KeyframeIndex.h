@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace std
+{
+	class thread;
+}
+
+struct AVFormatContext;
+struct AVCodecContext;
+struct AVPacket;
+struct AVFrame;
+
+namespace LiveKit
+{
+	// Keyframes of a video stream, so that a seek can start decoding at the last keyframe before its
+	// target instead of wherever the demuxer lands. The stream is scanned without decoding, on a thread
+	// with a demuxer of its own. Until the scan completes, seek() falls back to the demuxer's own search.
+	class KeyframeIndex
+	{
+	public:
+		struct Keyframe
+		{
+			int64_t pts; // stream time base
+			int64_t dts;
+		};
+
+		KeyframeIndex(const char* fn, int stream_index);
+		~KeyframeIndex();
+
+		bool is_ready() const { return m_ready; }
+
+		// the last keyframe shown at or before 'pts', nullptr if there is none or the scan is not complete
+		const Keyframe* find(int64_t pts) const;
+
+		// positions the demuxer so that decode_to_frame() reaches 'pts' with as few frames as possible,
+		// and discards what the decoder holds from before
+		void seek(AVFormatContext* fmt_ctx, AVCodecContext* codec_ctx, int64_t pts) const;
+
+		// keep indices in a file next to the media ("<fn>.lkidx"), so that the scan is done once per file
+		static void s_set_sidecar(bool enable);
+
+	private:
+		std::string m_fn;
+		int m_stream_index;
+		std::vector<Keyframe> m_keyframes; // in pts order
+		std::atomic<bool> m_ready;
+		std::atomic<bool> m_scanning;
+
+		bool _scan();
+		bool _load(const std::string& path);
+		void _save(const std::string& path) const;
+
+		static void thread_scan(KeyframeIndex* self);
+		std::unique_ptr<std::thread> m_thread_scan;
+	};
+
+	// decodes from the current demuxer position up to the first frame of 'stream_index' shown at or after
+	// 'pts', returns false if the stream ends first. Frames already held by the decoder are considered first,
+	// so consecutive calls step through the stream.
+	bool decode_to_frame(AVFormatContext* fmt_ctx, AVCodecContext* codec_ctx, int stream_index, int64_t pts, AVPacket* packet, AVFrame* frame);
+
+}
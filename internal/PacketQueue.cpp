@@ -0,0 +1,197 @@
+#include "PacketQueue.h"
+#include "AtomicWait.h"
+#include "Utils.h"
+
+namespace LiveKit
+{
+	const size_t PacketQueue::s_default_max_packets;
+	const uint64_t PacketQueue::s_min_read_ahead;
+	const uint64_t PacketQueue::s_initial_read_ahead;
+	const uint64_t PacketQueue::s_max_read_ahead;
+	const uint64_t PacketQueue::s_shrink_interval;
+
+	PacketQueue::PacketQueue(size_t max_bytes, int time_base_num, int time_base_den, size_t max_packets)
+		: m_max_bytes(max_bytes), m_slots(max_packets), m_slot_times(max_packets)
+		, m_write(0), m_read(0), m_bytes_in(0), m_bytes_out(0), m_eof(false)
+		, m_target_duration(s_initial_read_ahead), m_underruns(0), m_primed(false), m_last_underrun_time(0)
+		, m_signal(0), m_waiters(0)
+	{
+		m_time_base.num = time_base_num;
+		m_time_base.den = time_base_den;
+		for (size_t i = 0; i < m_slots.size(); i++)
+		{
+			m_slots[i] = av_packet_alloc();
+			m_slot_times[i] = 0;
+		}
+		m_last_adjust_time = time_micro_sec();
+	}
+
+	PacketQueue::~PacketQueue()
+	{
+		Clear();
+		for (size_t i = 0; i < m_slots.size(); i++)
+			av_packet_free(&m_slots[i]);
+	}
+
+	size_t PacketQueue::Size() const
+	{
+		return (size_t)(m_write.load() - m_read.load());
+	}
+
+	PacketQueueStats PacketQueue::GetStats() const
+	{
+		PacketQueueStats stats;
+		uint64_t read = m_read.load();
+		uint64_t write = m_write.load();
+		stats.packets = (size_t)(write - read);
+		stats.bytes = (size_t)(m_bytes_in.load() - m_bytes_out.load());
+		stats.duration = _duration(read, write);
+		stats.target_duration = m_target_duration.load();
+		stats.underruns = m_underruns.load();
+		return stats;
+	}
+
+	int64_t PacketQueue::_packet_time(const AVPacket* packet) const
+	{
+		int64_t t = packet->dts != AV_NOPTS_VALUE ? packet->dts : packet->pts;
+		if (t == AV_NOPTS_VALUE)
+		{
+			// untimed packets do not extend the queue's duration
+			uint64_t write = m_write.load(std::memory_order_relaxed);
+			return write > 0 ? m_slot_times[(write - 1) % m_slots.size()].load() : 0;
+		}
+		AVRational micro_sec = { 1, 1000000 };
+		return av_rescale_q(t, m_time_base, micro_sec);
+	}
+
+	uint64_t PacketQueue::_duration(uint64_t read, uint64_t write) const
+	{
+		if (write <= read) return 0;
+		int64_t oldest = m_slot_times[read % m_slots.size()].load();
+		int64_t newest = m_slot_times[(write - 1) % m_slots.size()].load();
+		return newest > oldest ? (uint64_t)(newest - oldest) : 0;
+	}
+
+	bool PacketQueue::_has_space(uint64_t write) const
+	{
+		uint64_t read = m_read.load();
+		uint64_t queued = write - read;
+		// a single packet is always accepted, however large
+		if (queued == 0) return true;
+		if (queued >= m_slots.size()) return false;
+		if (m_bytes_in.load() - m_bytes_out.load() >= m_max_bytes) return false;
+		return _duration(read, write) < m_target_duration.load();
+	}
+
+	void PacketQueue::_signal()
+	{
+		m_signal++;
+		if (m_waiters.load() > 0)
+			atomic_notify_all(&m_signal);
+	}
+
+	template <typename Ready>
+	bool PacketQueue::_wait(Ready ready, const std::atomic<bool>& running) const
+	{
+		if (ready()) return true;
+		m_waiters++;
+		while (true)
+		{
+			// the signal is read before the condition, a change in between makes atomic_wait() return at once
+			uint32_t signal = m_signal.load();
+			if (ready() || !running) break;
+			atomic_wait(&m_signal, signal);
+		}
+		m_waiters--;
+		return ready();
+	}
+
+	bool PacketQueue::Push(AVPacket* packet, const std::atomic<bool>& running)
+	{
+		uint64_t write = m_write.load(std::memory_order_relaxed);
+		if (!_has_space(write))
+		{
+			// the source keeps the queue full, give back some read-ahead if it has not run dry for a while
+			uint64_t now = time_micro_sec();
+			uint64_t last_adjust = max(m_last_adjust_time, m_last_underrun_time.load());
+			if (now - last_adjust >= s_shrink_interval)
+			{
+				uint64_t target = m_target_duration.load() * 3 / 4;
+				m_target_duration = max(target, s_min_read_ahead);
+				m_last_adjust_time = now;
+			}
+		}
+
+		bool ready = _wait([this, write]() { return _has_space(write); }, running);
+		if (!ready || !running) return false;
+
+		m_slot_times[write % m_slots.size()] = _packet_time(packet);
+		m_bytes_in += (uint64_t)packet->size;
+		av_packet_move_ref(m_slots[write % m_slots.size()], packet);
+		m_write.store(write + 1);
+		_signal();
+		return true;
+	}
+
+	bool PacketQueue::Pop(AVPacket* packet, const std::atomic<bool>& running)
+	{
+		if (Peek(running) == nullptr) return false;
+
+		uint64_t read = m_read.load(std::memory_order_relaxed);
+		AVPacket* slot = m_slots[read % m_slots.size()];
+		m_bytes_out += (uint64_t)slot->size;
+		av_packet_move_ref(packet, slot);
+		m_read.store(read + 1);
+		m_primed = true;
+		_signal();
+		return true;
+	}
+
+	const AVPacket* PacketQueue::Peek(const std::atomic<bool>& running) const
+	{
+		uint64_t read = m_read.load(std::memory_order_relaxed);
+		if (m_write.load() == read && !m_eof.load() && m_primed.load() && running)
+		{
+			// ran dry mid-stream, read further ahead from now on
+			m_underruns++;
+			uint64_t target = m_target_duration.load() * 2;
+			m_target_duration = min(target, s_max_read_ahead);
+			m_last_underrun_time = time_micro_sec();
+		}
+
+		_wait([this, read]() { return m_write.load() > read || m_eof.load(); }, running);
+		if (!running) return nullptr;
+		return TryPeek();
+	}
+
+	const AVPacket* PacketQueue::TryPeek() const
+	{
+		uint64_t read = m_read.load(std::memory_order_relaxed);
+		if (m_write.load() == read) return nullptr;
+		return m_slots[read % m_slots.size()];
+	}
+
+	void PacketQueue::SetEOF()
+	{
+		m_eof = true;
+		_signal();
+	}
+
+	void PacketQueue::Wake()
+	{
+		m_signal++;
+		atomic_notify_all(&m_signal);
+	}
+
+	void PacketQueue::Clear()
+	{
+		uint64_t write = m_write.load();
+		for (uint64_t read = m_read.load(); read < write; read++)
+			av_packet_unref(m_slots[read % m_slots.size()]);
+		m_read = write;
+		m_bytes_out = m_bytes_in.load();
+		m_eof = false;
+		m_primed = false;
+		m_last_adjust_time = time_micro_sec();
+	}
+}
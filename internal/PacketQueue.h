@@ -0,0 +1,103 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+namespace LiveKit
+{
+	struct PacketQueueStats
+	{
+		size_t packets = 0;
+		size_t bytes = 0;
+		uint64_t duration = 0; // microseconds of stream time queued
+		uint64_t target_duration = 0; // current read-ahead in microseconds
+		uint64_t underruns = 0; // times the consumer found the queue empty before the end of the stream
+	};
+
+	// Bounded single-producer/single-consumer ring of demuxed packets, between a demuxer thread and
+	// a decoder thread. Packets are moved in and out with av_packet_move_ref(), the slots are allocated
+	// once. The calls only go to the kernel when the ring is empty or full.
+	// The queue counts as full when it holds 'max_bytes' or its read-ahead duration, whichever comes
+	// first. The read-ahead grows each time the consumer runs dry and shrinks back slowly while the
+	// producer keeps up, so jittery sources get a deeper buffer than fast local files.
+	// Blocking calls give up when the 'running' flag passed to them is cleared and Wake() is called,
+	// or, for the consumer side, once the ring has run dry after SetEOF().
+	class PacketQueue
+	{
+	public:
+		PacketQueue(size_t max_bytes, int time_base_num, int time_base_den, size_t max_packets = s_default_max_packets);
+		~PacketQueue();
+
+		size_t Size() const;
+		PacketQueueStats GetStats() const;
+
+		// producer: blocks while the queue is full, then takes over the reference of 'packet' and blanks it.
+		// returns false if 'running' was cleared, 'packet' is then left untouched.
+		bool Push(AVPacket* packet, const std::atomic<bool>& running);
+
+		// consumer: blocks while the ring is empty, then moves the oldest packet to the blank 'packet'.
+		// returns false if 'running' was cleared or the stream has ended.
+		bool Pop(AVPacket* packet, const std::atomic<bool>& running);
+
+		// consumer: the oldest packet without removing it, valid until the next Pop().
+		// nullptr under the same conditions as Pop() failing.
+		const AVPacket* Peek(const std::atomic<bool>& running) const;
+
+		// non-blocking variant of Peek()
+		const AVPacket* TryPeek() const;
+
+		// no more packets will be pushed
+		void SetEOF();
+
+		// makes blocked calls re-check their 'running' flag
+		void Wake();
+
+		// unrefs the queued packets and clears EOF, neither side may be active
+		void Clear();
+
+		static const size_t s_default_max_packets = 2048;
+
+		// read-ahead range, in microseconds
+		static const uint64_t s_min_read_ahead = 500000;
+		static const uint64_t s_initial_read_ahead = 1000000;
+		static const uint64_t s_max_read_ahead = 10000000;
+
+		// the read-ahead shrinks after this long without an underrun, in microseconds
+		static const uint64_t s_shrink_interval = 5000000;
+
+	private:
+		size_t m_max_bytes;
+		AVRational m_time_base;
+
+		std::vector<AVPacket*> m_slots;
+		std::vector<std::atomic<int64_t>> m_slot_times; // microseconds, written by the producer only
+		std::atomic<uint64_t> m_write; // packets pushed so far
+		std::atomic<uint64_t> m_read; // packets popped so far
+		std::atomic<uint64_t> m_bytes_in;
+		std::atomic<uint64_t> m_bytes_out;
+		std::atomic<bool> m_eof;
+
+		mutable std::atomic<uint64_t> m_target_duration;
+		mutable std::atomic<uint64_t> m_underruns;
+		mutable std::atomic<bool> m_primed; // the consumer has received a packet since the last Clear()
+		uint64_t m_last_adjust_time = 0; // producer side, local time of the last underrun or shrink
+		mutable std::atomic<uint64_t> m_last_underrun_time;
+
+		// bumped on every state change, the waiting side sleeps on it
+		mutable std::atomic<uint32_t> m_signal;
+		mutable std::atomic<uint32_t> m_waiters;
+
+		int64_t _packet_time(const AVPacket* packet) const;
+		uint64_t _duration(uint64_t read, uint64_t write) const;
+		bool _has_space(uint64_t write) const;
+		void _signal();
+		template <typename Ready>
+		bool _wait(Ready ready, const std::atomic<bool>& running) const;
+	};
+
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <condition_variable>
+
+namespace LiveKit
+{
+	// Holds the worker threads of a pipeline at the end of their run, so that a controlling thread can
+	// reset the state they share (flush queues and decoders, reposition a demuxer) and let them run again,
+	// instead of ending the threads and creating new ones.
+	// Workers stop their run the same way they would for good (their 'running' flag is cleared and the
+	// queues are woken), then call Park().
+	class PauseGate
+	{
+	public:
+		PauseGate(int workers) : m_workers(workers) {}
+
+		// worker: waits for Release(), returns false once Close() has been called and the thread should exit
+		bool Park()
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			uint64_t round = m_round;
+			m_parked++;
+			m_cond_parked.notify_all();
+			m_cond_release.wait(lock, [this, round]() { return m_closed || m_round != round; });
+			return !m_closed;
+		}
+
+		// controller: waits until every worker has parked
+		void WaitParked()
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_cond_parked.wait(lock, [this]() { return m_closed || m_parked >= m_workers; });
+		}
+
+		// controller: the parked workers go on with a new run
+		void Release()
+		{
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_parked = 0;
+				m_round++;
+			}
+			m_cond_release.notify_all();
+		}
+
+		void Close()
+		{
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_closed = true;
+			}
+			m_cond_release.notify_all();
+			m_cond_parked.notify_all();
+		}
+
+	private:
+		int m_workers;
+		int m_parked = 0;
+		uint64_t m_round = 0;
+		bool m_closed = false;
+		std::mutex m_mutex;
+		std::condition_variable m_cond_parked;
+		std::condition_variable m_cond_release;
+	};
+
+}
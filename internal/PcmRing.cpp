@@ -0,0 +1,129 @@
+#include "PcmRing.h"
+#include "AtomicWait.h"
+#include <cstring>
+
+namespace LiveKit
+{
+	PcmRing::PcmRing(size_t capacity, int samplerate)
+		: m_samplerate(samplerate), m_buf(capacity * 2, 0), m_write(0), m_read(0), m_eof(false)
+		, m_seq(0), m_end_position(0), m_end_time(-1), m_signal(0), m_waiters(0)
+	{
+
+	}
+
+	PcmRing::~PcmRing()
+	{
+
+	}
+
+	size_t PcmRing::Available() const
+	{
+		return (size_t)(m_write.load() - m_read.load());
+	}
+
+	bool PcmRing::WaitSpace(size_t size, const std::atomic<bool>& running)
+	{
+		if (size > Capacity()) size = Capacity();
+		uint64_t write = m_write.load(std::memory_order_relaxed);
+		auto ready = [this, write, size]() { return write + size - m_read.load() <= Capacity(); };
+		if (ready()) return true;
+
+		m_waiters++;
+		while (true)
+		{
+			uint32_t signal = m_signal.load();
+			if (ready() || !running) break;
+			atomic_wait(&m_signal, signal);
+		}
+		m_waiters--;
+		return running && ready();
+	}
+
+	size_t PcmRing::Write(const short* data, size_t size, int64_t end_time)
+	{
+		uint64_t write = m_write.load(std::memory_order_relaxed);
+		size_t space = Capacity() - (size_t)(write - m_read.load());
+		size_t requested = size;
+		if (size > space) size = space;
+		if (size == 0) return 0;
+
+		size_t pos = (size_t)(write % Capacity());
+		size_t first = Capacity() - pos;
+		if (first > size) first = size;
+		memcpy(m_buf.data() + pos * 2, data, first * 2 * sizeof(short));
+		memcpy(m_buf.data(), data + first * 2, (size - first) * 2 * sizeof(short));
+
+		// a partial write ends before 'end_time'
+		uint64_t end_position = write + size;
+		int64_t time = end_time;
+		if (time >= 0)
+			time -= (int64_t)(requested - size) * 1000000 / m_samplerate;
+
+		uint32_t seq = m_seq.load(std::memory_order_relaxed);
+		m_seq.store(seq + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		m_end_position.store(end_position, std::memory_order_relaxed);
+		m_end_time.store(time, std::memory_order_relaxed);
+		m_seq.store(seq + 2, std::memory_order_release);
+
+		m_write.store(end_position);
+		return size;
+	}
+
+	void PcmRing::SetEOF()
+	{
+		m_eof = true;
+	}
+
+	size_t PcmRing::Read(short* data, size_t size)
+	{
+		uint64_t read = m_read.load(std::memory_order_relaxed);
+		size_t available = (size_t)(m_write.load() - read);
+		if (size > available) size = available;
+		if (size == 0) return 0;
+
+		size_t pos = (size_t)(read % Capacity());
+		size_t first = Capacity() - pos;
+		if (first > size) first = size;
+		memcpy(data, m_buf.data() + pos * 2, first * 2 * sizeof(short));
+		memcpy(data + first * 2, m_buf.data(), (size - first) * 2 * sizeof(short));
+		m_read.store(read + size);
+
+		m_signal++;
+		if (m_waiters.load() > 0)
+			atomic_notify_all(&m_signal);
+		return size;
+	}
+
+	int64_t PcmRing::TimeAt(uint64_t position) const
+	{
+		uint64_t end_position;
+		int64_t end_time;
+		while (true)
+		{
+			uint32_t seq = m_seq.load(std::memory_order_acquire);
+			end_position = m_end_position.load(std::memory_order_relaxed);
+			end_time = m_end_time.load(std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if ((seq & 1) == 0 && m_seq.load(std::memory_order_relaxed) == seq) break;
+		}
+		if (end_time < 0) return -1;
+		int64_t behind = (int64_t)(end_position - position);
+		if (m_rate == 1.0)
+			return end_time - behind * 1000000 / m_samplerate;
+		return end_time - (int64_t)((double)behind * 1000000.0 * m_rate / (double)m_samplerate);
+	}
+
+	void PcmRing::Wake()
+	{
+		m_signal++;
+		atomic_notify_all(&m_signal);
+	}
+
+	void PcmRing::Clear()
+	{
+		m_read = m_write.load();
+		m_eof = false;
+		m_end_time = -1;
+	}
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace LiveKit
+{
+	// Lock-free single-producer/single-consumer ring of interleaved stereo s16 samples, between a decoder
+	// thread and a real-time audio callback. The consumer side never blocks or takes a lock.
+	// Along with the samples, the producer publishes the media time they end at, so that the consumer
+	// can tell the time of what it is playing.
+	class PcmRing
+	{
+	public:
+		PcmRing(size_t capacity, int samplerate);
+		~PcmRing();
+
+		size_t Capacity() const { return m_buf.size() / 2; }
+		size_t Available() const;
+
+		// producer: blocks until 'size' samples fit, returns false if 'running' was cleared and Wake() called
+		bool WaitSpace(size_t size, const std::atomic<bool>& running);
+
+		// producer: appends up to 'size' samples, the last of them ending at 'end_time' (microseconds),
+		// returns the number of samples written
+		size_t Write(const short* data, size_t size, int64_t end_time);
+
+		// producer: no more samples will be written
+		void SetEOF();
+		bool IsEOF() const { return m_eof.load(); }
+
+		// consumer: takes up to 'size' samples, returns the number read
+		size_t Read(short* data, size_t size);
+		uint64_t ReadPosition() const { return m_read.load(); }
+
+		// media time of the sample at 'position' in microseconds, -1 if unknown
+		int64_t TimeAt(uint64_t position) const;
+
+		// media time passed per sample played, relative to the sample rate, for time-stretched audio.
+		// neither side may be active
+		void SetRate(double rate) { m_rate = rate; }
+
+		// makes a blocked WaitSpace() re-check its 'running' flag
+		void Wake();
+
+		// neither side may be active
+		void Clear();
+
+	private:
+		int m_samplerate;
+		double m_rate = 1.0;
+		std::vector<short> m_buf;
+		std::atomic<uint64_t> m_write; // samples written so far
+		std::atomic<uint64_t> m_read; // samples read so far
+		std::atomic<bool> m_eof;
+
+		// m_write and the time of the sample before it, published together through a sequence lock
+		std::atomic<uint32_t> m_seq;
+		std::atomic<uint64_t> m_end_position;
+		std::atomic<int64_t> m_end_time;
+
+		std::atomic<uint32_t> m_signal;
+		std::atomic<uint32_t> m_waiters;
+	};
+
+}
@@ -0,0 +1,169 @@
+#include "SliceScaler.h"
+#include "WorkerPool.h"
+
+#include <cstring>
+
+extern "C" {
+#include <libavutil/imgutils.h>
+#include <libavutil/mem.h>
+#include <libavutil/pixdesc.h>
+#include <libswscale/swscale.h>
+}
+
+namespace LiveKit
+{
+	// slices shorter than this cost more in scheduling than they gain
+	static const int s_min_slice_height = 64;
+	// fewer slices do not make up for converting the overlaps and copying out of the slice buffers
+	static const int s_min_slices = 3;
+	// slice starts are kept on multiples of this, which any chroma subsampling divides
+	static const int s_slice_alignment = 16;
+	// rows converted on either side of a slice, more than the vertical chroma filters of the bilinear
+	// and bicubic modes reach. A multiple of s_slice_alignment, so that chroma rows line up as well
+	static const int s_slice_overlap = 16;
+
+	SliceScaler::SliceScaler(int flags, WorkerPool* pool)
+		: m_flags(flags), m_pool(pool != nullptr ? pool : &WorkerPool::s_get_instance())
+	{
+
+	}
+
+	SliceScaler::~SliceScaler()
+	{
+		_clear();
+	}
+
+	void SliceScaler::_clear()
+	{
+		for (size_t i = 0; i < m_slices.size(); i++)
+		{
+			sws_freeContext(m_slices[i].ctx);
+			av_freep(&m_slices[i].buffer[0]);
+		}
+		m_slices.clear();
+	}
+
+	void SliceScaler::_configure(int src_width, int src_height, int src_fmt, int dst_width, int dst_height, int dst_fmt)
+	{
+		if (!m_slices.empty() && src_width == m_src_width && src_height == m_src_height && src_fmt == m_src_fmt
+			&& dst_width == m_dst_width && dst_height == m_dst_height && dst_fmt == m_dst_fmt)
+			return;
+
+		_clear();
+		m_src_width = src_width;
+		m_src_height = src_height;
+		m_src_fmt = src_fmt;
+		m_dst_width = dst_width;
+		m_dst_height = dst_height;
+		m_dst_fmt = dst_fmt;
+
+		// with an odd height swscale maps chroma rows at a ratio slightly off 2:1, which slices cannot reproduce
+		const AVPixFmtDescriptor* src_desc = av_pix_fmt_desc_get((AVPixelFormat)src_fmt);
+		const AVPixFmtDescriptor* dst_desc = av_pix_fmt_desc_get((AVPixelFormat)dst_fmt);
+		bool uneven_chroma = (src_height & 1) != 0 && (src_desc->log2_chroma_h > 0 || dst_desc->log2_chroma_h > 0);
+
+		int num_slices = 1;
+		if (src_height == dst_height && !uneven_chroma)
+		{
+			num_slices = src_height / s_min_slice_height;
+			if (num_slices > m_pool->num_threads() + 1) num_slices = m_pool->num_threads() + 1;
+			if (num_slices < 1) num_slices = 1;
+		}
+
+		int slice_height = (src_height + num_slices - 1) / num_slices;
+		slice_height = (slice_height + s_slice_alignment - 1) / s_slice_alignment * s_slice_alignment;
+		num_slices = (src_height + slice_height - 1) / slice_height;
+		if (num_slices < s_min_slices) num_slices = 1;
+
+		if (num_slices == 1)
+		{
+			Slice slice = {};
+			slice.height = dst_height;
+			slice.src_height = src_height;
+			slice.ctx = sws_getContext(src_width, src_height, (AVPixelFormat)src_fmt, dst_width, dst_height, (AVPixelFormat)dst_fmt, m_flags, nullptr, nullptr, nullptr);
+			m_slices.push_back(slice);
+			return;
+		}
+
+		for (int y = 0; y < src_height; y += slice_height)
+		{
+			Slice slice = {};
+			slice.y = y;
+			slice.height = src_height - y < slice_height ? src_height - y : slice_height;
+			slice.src_y = y - s_slice_overlap > 0 ? y - s_slice_overlap : 0;
+			int src_end = y + slice.height + s_slice_overlap;
+			if (src_end > src_height) src_end = src_height;
+			slice.src_height = src_end - slice.src_y;
+			slice.ctx = sws_getContext(src_width, slice.src_height, (AVPixelFormat)src_fmt, dst_width, slice.src_height, (AVPixelFormat)dst_fmt, m_flags, nullptr, nullptr, nullptr);
+			av_image_alloc(slice.buffer, slice.buffer_linesize, dst_width, slice.src_height, (AVPixelFormat)dst_fmt, 64);
+			m_slices.push_back(slice);
+		}
+	}
+
+	// planes 1 and 2 hold subsampled chroma
+	inline int s_plane_row(const AVPixFmtDescriptor* desc, int plane, int y)
+	{
+		return (plane == 1 || plane == 2) ? y >> desc->log2_chroma_h : y;
+	}
+
+	// the end of the plane rows that cover the image rows before 'y'
+	inline int s_plane_end(const AVPixFmtDescriptor* desc, int plane, int y)
+	{
+		return (plane == 1 || plane == 2) ? (y + (1 << desc->log2_chroma_h) - 1) >> desc->log2_chroma_h : y;
+	}
+
+	// pointers to row 'y' of every plane
+	inline void s_offset_planes(const uint8_t* const data[], const int linesize[], int fmt, int y, const uint8_t* out[4])
+	{
+		const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get((AVPixelFormat)fmt);
+		int num_planes = av_pix_fmt_count_planes((AVPixelFormat)fmt);
+		for (int i = 0; i < 4; i++)
+		{
+			if (i >= num_planes || data[i] == nullptr)
+			{
+				out[i] = nullptr;
+				continue;
+			}
+			out[i] = data[i] + (ptrdiff_t)s_plane_row(desc, i, y) * linesize[i];
+		}
+	}
+
+	void SliceScaler::_run_slice(const Slice& slice, const uint8_t* const src_data[], const int src_linesize[], uint8_t* const dst_data[], const int dst_linesize[]) const
+	{
+		const uint8_t* src[4];
+		s_offset_planes(src_data, src_linesize, m_src_fmt, slice.src_y, src);
+		sws_scale(slice.ctx, src, src_linesize, 0, slice.src_height, slice.buffer, slice.buffer_linesize);
+
+		// only the slice's own rows leave the buffer, the overlap is converted again by the neighbours
+		AVPixelFormat dst_fmt = (AVPixelFormat)m_dst_fmt;
+		const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(dst_fmt);
+		int num_planes = av_pix_fmt_count_planes(dst_fmt);
+		for (int i = 0; i < num_planes; i++)
+		{
+			int row_size = av_image_get_linesize(dst_fmt, m_dst_width, i);
+			int first = s_plane_row(desc, i, slice.y);
+			int end = s_plane_end(desc, i, slice.y + slice.height);
+			const uint8_t* p_in = slice.buffer[i] + (ptrdiff_t)(first - s_plane_row(desc, i, slice.src_y)) * slice.buffer_linesize[i];
+			uint8_t* p_out = dst_data[i] + (ptrdiff_t)first * dst_linesize[i];
+			for (int y = first; y < end; y++, p_in += slice.buffer_linesize[i], p_out += dst_linesize[i])
+				memcpy(p_out, p_in, row_size);
+		}
+	}
+
+	void SliceScaler::scale(const uint8_t* const src_data[], const int src_linesize[], int src_width, int src_height, int src_fmt,
+		uint8_t* const dst_data[], const int dst_linesize[], int dst_width, int dst_height, int dst_fmt)
+	{
+		_configure(src_width, src_height, src_fmt, dst_width, dst_height, dst_fmt);
+
+		if (m_slices.size() == 1)
+		{
+			sws_scale(m_slices[0].ctx, src_data, src_linesize, 0, src_height, dst_data, dst_linesize);
+			return;
+		}
+
+		m_pool->run((int)m_slices.size(), [&](int i)
+		{
+			_run_slice(m_slices[i], src_data, src_linesize, dst_data, dst_linesize);
+		});
+	}
+}
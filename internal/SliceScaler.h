@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+struct SwsContext;
+
+namespace LiveKit
+{
+	class WorkerPool;
+
+	// sws_scale split into horizontal slices that run in parallel on a WorkerPool, with one swscale
+	// context per slice. Vertical chroma filters reach across slice boundaries, so each slice converts
+	// a few rows of its neighbours as well, into a buffer of its own, and copies out only its rows; the
+	// result is the same as that of a single pass. Only conversions that keep the height are sliced, and
+	// with subsampled chroma only even heights; others run in one piece on the calling thread.
+	class SliceScaler
+	{
+	public:
+		// 'flags' are SWS_* flags, the shared pool is used when 'pool' is null
+		SliceScaler(int flags, WorkerPool* pool = nullptr);
+		~SliceScaler();
+
+		// AVPixelFormat values are passed as int to keep FFmpeg headers out of here
+		void scale(const uint8_t* const src_data[], const int src_linesize[], int src_width, int src_height, int src_fmt,
+			uint8_t* const dst_data[], const int dst_linesize[], int dst_width, int dst_height, int dst_fmt);
+
+		int num_slices() const { return (int)m_slices.size(); }
+
+	private:
+		struct Slice
+		{
+			SwsContext* ctx;
+			int y; // first row of the output this slice produces
+			int height;
+			int src_y; // the rows converted, including the overlap with the neighbours
+			int src_height;
+			uint8_t* buffer[4]; // output of the converted rows, unused with a single slice
+			int buffer_linesize[4];
+		};
+
+		void _run_slice(const Slice& slice, const uint8_t* const src_data[], const int src_linesize[], uint8_t* const dst_data[], const int dst_linesize[]) const;
+
+		void _configure(int src_width, int src_height, int src_fmt, int dst_width, int dst_height, int dst_fmt);
+		void _clear();
+
+		int m_flags;
+		WorkerPool* m_pool;
+		std::vector<Slice> m_slices;
+
+		int m_src_width = -1;
+		int m_src_height = -1;
+		int m_src_fmt = -1;
+		int m_dst_width = -1;
+		int m_dst_height = -1;
+		int m_dst_fmt = -1;
+	};
+
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+namespace LiveKit
+{
+	// Small bounded queue between two threads of a processing pipeline, for items that are handed over
+	// a few times per frame. Like PacketQueue, blocking calls give up when the 'running' flag passed to
+	// them is cleared and Wake() is called, and Pop() fails once the queue has drained after SetEOF().
+	template <typename T>
+	class StageQueue
+	{
+	public:
+		StageQueue(size_t capacity) : m_capacity(capacity) {}
+
+		size_t Size() const
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			return m_items.size();
+		}
+
+		bool Push(const T& item, const std::atomic<bool>& running)
+		{
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_cond_in.wait(lock, [this, &running]() { return !running || m_items.size() < m_capacity; });
+				if (!running) return false;
+				m_items.push_back(item);
+			}
+			m_cond_out.notify_one();
+			return true;
+		}
+
+		bool Pop(T* item, const std::atomic<bool>& running)
+		{
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_cond_out.wait(lock, [this, &running]() { return !running || m_eof || m_items.size() > 0; });
+				if (!running || m_items.size() == 0) return false;
+				*item = m_items.front();
+				m_items.pop_front();
+			}
+			m_cond_in.notify_one();
+			return true;
+		}
+
+		// copies the oldest item without removing it, does not block
+		bool TryPeek(T* item) const
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			if (m_items.size() == 0) return false;
+			*item = m_items.front();
+			return true;
+		}
+
+		// drops the queued items and clears EOF, neither side may be active
+		void Clear()
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_items.clear();
+			m_eof = false;
+		}
+
+		void SetEOF()
+		{
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_eof = true;
+			}
+			m_cond_out.notify_all();
+		}
+
+		void Wake()
+		{
+			{
+				// taking the lock orders the caller's change of 'running' before the waiters' next check
+				std::unique_lock<std::mutex> lock(m_mutex);
+			}
+			m_cond_in.notify_all();
+			m_cond_out.notify_all();
+		}
+
+	private:
+		size_t m_capacity;
+		std::deque<T> m_items;
+		bool m_eof = false;
+		mutable std::mutex m_mutex;
+		std::condition_variable m_cond_in;
+		std::condition_variable m_cond_out;
+	};
+
+}
@@ -0,0 +1,80 @@
+#include "TargetConverter.h"
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+namespace LiveKit
+{
+	void TargetConverter::convert(const AVFrame* frame, const std::vector<VideoTarget*>& targets, std::vector<ImageRef>& images)
+	{
+		for (size_t i = 0; i < m_outputs.size(); i++)
+			m_outputs[i]->image = nullptr;
+
+		images.resize(targets.size());
+		for (size_t i = 0; i < targets.size(); i++)
+		{
+			int width = frame->width;
+			int height = frame->height;
+			PixelFormat format = m_native_format;
+
+			VideoFormatRequest request;
+			if (targets[i]->get_format_request(&request))
+				s_resolve(request, width, height, format);
+
+			Output* output = nullptr;
+			for (size_t j = 0; j < m_outputs.size() && output == nullptr; j++)
+			{
+				Output* o = m_outputs[j].get();
+				if (o->width == width && o->height == height && o->format == format)
+					output = o;
+			}
+			if (output == nullptr)
+			{
+				output = new Output;
+				output->width = width;
+				output->height = height;
+				output->format = format;
+				m_outputs.push_back((std::unique_ptr<Output>)(output));
+			}
+
+			if (output->image == nullptr)
+			{
+				std::shared_ptr<Image> image = output->buffers.get(width, height, format);
+				output->converter.frame_to_image(frame, image.get());
+				output->image = image;
+			}
+			images[i] = output->image;
+		}
+
+		// requests that nobody makes any more
+		for (size_t i = 0; i < m_outputs.size(); )
+		{
+			if (m_outputs[i]->image == nullptr)
+			{
+				m_outputs.erase(m_outputs.begin() + i);
+				continue;
+			}
+			i++;
+		}
+	}
+
+	void TargetConverter::s_resolve(const VideoFormatRequest& request, int& width, int& height, PixelFormat& format)
+	{
+		// scaling up is left to the consumer, which usually draws with a GPU anyway
+		if (request.width > 0 && request.height > 0)
+		{
+			if (request.width < width) width = request.width;
+			if (request.height < height) height = request.height;
+		}
+		if (request.packed && Image::s_is_planar(format))
+			format = PixelFormat::BGRX;
+	}
+
+	void TargetConverter::s_present(const std::vector<VideoTarget*>& targets, const std::vector<ImageRef>& images)
+	{
+		for (size_t i = 0; i < targets.size() && i < images.size(); i++)
+			targets[i]->write_image(images[i]);
+	}
+
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "Image.h"
+#include "ImageRecycler.h"
+#include "ImageConverter.h"
+#include "VideoPort.h"
+#include <memory>
+#include <vector>
+
+struct AVFrame;
+
+namespace LiveKit
+{
+	// Converts a producer's frames for its targets, once per distinct size and format they ask for
+	// (see VideoTarget::get_format_request()). Targets without a request share one image in the
+	// frame's own size and the producer's native format.
+	class TargetConverter
+	{
+	public:
+		TargetConverter(PixelFormat native_format) : m_native_format(native_format) {}
+		~TargetConverter() {}
+
+		// 'images' receives one image per target, targets whose requests resolve alike get the same image
+		void convert(const AVFrame* frame, const std::vector<VideoTarget*>& targets, std::vector<ImageRef>& images);
+
+		static void s_present(const std::vector<VideoTarget*>& targets, const std::vector<ImageRef>& images);
+
+		// narrows a frame's size and format down to what 'request' asks for
+		static void s_resolve(const VideoFormatRequest& request, int& width, int& height, PixelFormat& format);
+
+	private:
+		struct Output
+		{
+			int width;
+			int height;
+			PixelFormat format;
+			ImageRecycler buffers;
+			ImageConverter converter;
+			ImageRef image; // of the current frame
+		};
+
+		PixelFormat m_native_format;
+		std::vector<std::unique_ptr<Output>> m_outputs;
+	};
+
+}
@@ -0,0 +1,96 @@
+#include "WorkerPool.h"
+#include <algorithm>
+
+namespace LiveKit
+{
+	static const int s_max_shared_threads = 15;
+
+	WorkerPool::WorkerPool(int num_threads)
+	{
+		for (int i = 0; i < num_threads; i++)
+			m_threads.push_back(std::thread(thread_work, this));
+	}
+
+	WorkerPool::~WorkerPool()
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_running = false;
+		}
+		m_cv_work.notify_all();
+		for (size_t i = 0; i < m_threads.size(); i++)
+			m_threads[i].join();
+	}
+
+	WorkerPool& WorkerPool::s_get_instance()
+	{
+		static int s_num_threads = []()
+		{
+			int cores = (int)std::thread::hardware_concurrency();
+			int num_threads = cores - 1;
+			if (num_threads < 0) num_threads = 0;
+			if (num_threads > s_max_shared_threads) num_threads = s_max_shared_threads;
+			return num_threads;
+		}();
+		static WorkerPool s_pool(s_num_threads);
+		return s_pool;
+	}
+
+	// takes the next index of 'batch' and runs it with the lock released, false when none is left
+	bool WorkerPool::_run_one(Batch* batch, std::unique_lock<std::mutex>& lock)
+	{
+		if (batch->next >= batch->count) return false;
+		int index = batch->next++;
+		if (batch->next >= batch->count)
+			m_batches.erase(std::find(m_batches.begin(), m_batches.end(), batch));
+
+		lock.unlock();
+		(*batch->task)(index);
+		lock.lock();
+
+		if (++batch->finished == batch->count)
+			m_cv_done.notify_all();
+		return true;
+	}
+
+	void WorkerPool::thread_work(WorkerPool* self)
+	{
+		std::unique_lock<std::mutex> lock(self->m_mutex);
+		while (true)
+		{
+			self->m_cv_work.wait(lock, [self]() { return !self->m_running || !self->m_batches.empty(); });
+			if (!self->m_running) break;
+			self->_run_one(self->m_batches.front(), lock);
+		}
+	}
+
+	void WorkerPool::run(int count, const std::function<void(int)>& task)
+	{
+		if (count <= 0) return;
+		if (count == 1 || m_threads.empty())
+		{
+			for (int i = 0; i < count; i++)
+				task(i);
+			return;
+		}
+
+		Batch batch;
+		batch.task = &task;
+		batch.count = count;
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_batches.push_back(&batch);
+		if (count - 1 < (int)m_threads.size())
+		{
+			for (int i = 0; i < count - 1; i++)
+				m_cv_work.notify_one();
+		}
+		else
+		{
+			m_cv_work.notify_all();
+		}
+
+		while (_run_one(&batch, lock));
+		m_cv_done.wait(lock, [&batch]() { return batch.finished == batch.count; });
+	}
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace LiveKit
+{
+	// Fixed set of threads that run the indices of a batch in parallel. The calling thread takes part
+	// in its own batch, so a pool with no threads runs everything inline. Batches from several callers
+	// are queued and served in order, which keeps the number of busy threads bounded process-wide.
+	class WorkerPool
+	{
+	public:
+		WorkerPool(int num_threads);
+		~WorkerPool();
+
+		// shared by all converters, one thread less than the number of cores
+		static WorkerPool& s_get_instance();
+
+		int num_threads() const { return (int)m_threads.size(); }
+
+		// calls task(0) .. task(count - 1) and returns when all of them have finished
+		void run(int count, const std::function<void(int)>& task);
+
+	private:
+		struct Batch
+		{
+			const std::function<void(int)>* task;
+			int count;
+			int next = 0;
+			int finished = 0;
+		};
+
+		static void thread_work(WorkerPool* self);
+		bool _run_one(Batch* batch, std::unique_lock<std::mutex>& lock);
+
+		std::mutex m_mutex;
+		std::condition_variable m_cv_work;
+		std::condition_variable m_cv_done;
+		std::deque<Batch*> m_batches;
+		bool m_running = true;
+		std::vector<std::thread> m_threads;
+	};
+
+}
@@ -40,6 +40,12 @@ class VideoSource:
         Native.PullerGetData(self.puller_ptr, ffi.cast("unsigned char *", arr.__array_interface__['data'][0]))
         return arr, timestamp, is_flipped
 
+    def peek_timestamp(self):
+        return Native.PullerPeekTimestamp(self.puller_ptr)
+
+    def wait(self, timeout_ms = -1): # blocks until a frame newer than the last pulled one arrives, negative waits forever
+        return Native.PullerWait(self.puller_ptr, timeout_ms)!=0
+
 class VideoTarget:
     def __init__(self):
         self.pusher_ptr = Native.PusherCreate(self.target_ptr)
@@ -57,9 +63,35 @@ class VideoTarget:
         Native.PusherPush(self.pusher_ptr)
 
 
+def set_image_pool_capacity(capacity): # bytes kept by idle frame buffers
+    Native.ImagePoolSetCapacity(capacity)
+
+def set_image_pool_huge_pages(enable): # back large frame buffers with huge pages when permitted
+    Native.ImagePoolSetHugePages(enable)
+
+def set_keyframe_index_sidecar(enable): # keep seek indices of played files in "<file>.lkidx"
+    Native.KeyframeIndexSetSidecar(enable)
+
+class DecoderOptions:
+    thread_types = ("default", "frame", "slice")
+    skips = ("default", "nonref", "bidir", "nonintra", "nonkey", "all")
+
+    # thread_count 0 picks one per core, extra: further codec options by name, e.g. { "lowres": "1" }
+    def __init__(self, thread_count = 1, thread_type = "default", low_delay = False, skip_frame = "default", skip_loop_filter = "default", skip_idct = "default", extra = None):
+        self.cptr = Native.DecoderOptionsCreate(thread_count, DecoderOptions.thread_types.index(thread_type), low_delay,
+            DecoderOptions.skips.index(skip_frame), DecoderOptions.skips.index(skip_loop_filter), DecoderOptions.skips.index(skip_idct))
+        for name, value in (extra or {}).items():
+            Native.DecoderOptionsSet(self.cptr, name.encode('utf-8'), str(value).encode('utf-8'))
+
+    def __del__(self):
+        Native.DecoderOptionsDestroy(self.cptr)
+
+def _decoder_options_ptr(decoder_options):
+    return decoder_options.cptr if decoder_options is not None else ffi.NULL
+
 class VideoPort(VideoSource, VideoTarget):
-    def __init__(self):
-        self.cptr = Native.VideoPortCreate()
+    def __init__(self, depth = 3, lossless = False, write_timeout_ms = 500): # lossless: single reader gets every frame, writer blocks when full
+        self.cptr = Native.VideoPortCreate(depth, 1 if lossless else 0, write_timeout_ms)
         self.source_ptr = Native.VideoPortGetSourcePtr(self.cptr)
         self.target_ptr = Native.VideoPortGetTargetPtr(self.cptr)
         VideoSource.__init__(self)
@@ -70,9 +102,17 @@ class VideoPort(VideoSource, VideoTarget):
         VideoSource.__del__(self)
         Native.VideoPortDestroy(self.cptr)
 
+    def get_stats(self):
+        stats = ffi.new("unsigned long long[4]")
+        Native.VideoPortGetStats(self.cptr, stats)
+        return { "written": stats[0], "read": stats[1], "overwritten": stats[2], "dropped": stats[3] }
+
+    def reset_stats(self):
+        Native.VideoPortResetStats(self.cptr)
+
 class ImageFile(VideoSource):
-    def __init__(self, filename):
-        self.cptr = Native.ImageFileCreate(filename.encode('mbcs'))
+    def __init__(self, filename, decoder_options = None):
+        self.cptr = Native.ImageFileCreate(filename.encode('mbcs'), _decoder_options_ptr(decoder_options))
         self.source_ptr = Native.ImageFileGetSourcePtr(self.cptr)
         VideoSource.__init__(self)
 
@@ -94,8 +134,8 @@ class AudioOutputDeviceList(StringList):
         self.id_default = Native.GetDefaultAudioOutputDeviceID()
 
 class MediaInfo:
-    def __init__(self, filename):
-        self.cptr = Native.MediaInfoCreate(filename.encode('mbcs'))
+    def __init__(self, filename, decoder_options = None):
+        self.cptr = Native.MediaInfoCreate(filename.encode('mbcs'), _decoder_options_ptr(decoder_options))
 
     def __del__(self):
         Native.MediaInfoDestroy(self.cptr)
@@ -128,8 +168,8 @@ class MediaInfo:
         return Native.MediaInfoAudioBitrate(self.cptr)
 
 class Player:
-    def __init__(self, filename, play_audio = True, play_video = True, audio_device_id = 0):
-        self.cptr = Native.PlayerCreate(filename.encode('mbcs'), play_audio, play_video, audio_device_id)
+    def __init__(self, filename, play_audio = True, play_video = True, audio_device_id = 0, fast_start = False, live = False, decoder_options = None):
+        self.cptr = Native.PlayerCreate(filename.encode('mbcs'), play_audio, play_video, audio_device_id, fast_start, live, _decoder_options_ptr(decoder_options))
         self.targets = []
 
     def __del__(self):
@@ -166,9 +206,68 @@ class Player:
     def set_audio_device(self, audio_device_id):
         Native.PlayerSetAudioDevice(self.cptr, audio_device_id)
 
+    def get_queue_stats(self): # durations in seconds
+        result = {}
+        for name, video in (("audio", 0), ("video", 1)):
+            stats = ffi.new("unsigned long long[5]")
+            Native.PlayerGetQueueStats(self.cptr, video, stats)
+            result[name] = { "packets": stats[0], "bytes": stats[1], "duration": stats[2] / 1000000.0, "target_duration": stats[3] / 1000000.0, "underruns": stats[4] }
+        return result
+
+    def get_audio_stats(self): # counts in samples
+        stats = ffi.new("unsigned long long[4]")
+        Native.PlayerGetAudioStats(self.cptr, stats)
+        return { "underruns": stats[0], "underrun_samples": stats[1], "buffered_samples": stats[2], "capacity_samples": stats[3] }
+
+    def get_video_stats(self): # frames shed while behind, shedding_time in seconds
+        stats = ffi.new("unsigned long long[5]")
+        Native.PlayerGetVideoStats(self.cptr, stats)
+        return { "shed_decode": stats[0], "shed_convert": stats[1], "shed_present": stats[2], "shed_level": stats[3], "shedding_time": stats[4] / 1000000.0 }
+
+    def set_rate(self, rate, stretch_audio = True): # 0.25 to 16, audio muted when not stretched
+        Native.PlayerSetRate(self.cptr, rate, stretch_audio)
+
+    def get_rate(self):
+        return Native.PlayerGetRate(self.cptr)
+
+    def set_free_run(self, enable): # every frame as fast as targets accept, audio muted
+        Native.PlayerSetFreeRun(self.cptr, enable)
+
+    def is_free_run(self):
+        return Native.PlayerIsFreeRun(self.cptr) != 0
+
+    def append(self, filename): # played after the current file without a gap
+        Native.PlayerAppend(self.cptr, filename.encode('mbcs'))
+
+    def clear_playlist(self):
+        Native.PlayerClearPlaylist(self.cptr)
+
+    def set_loop(self, loop):
+        Native.PlayerSetLoop(self.cptr, loop)
+
+    def is_looping(self):
+        return Native.PlayerIsLooping(self.cptr) != 0
+
+    def get_startup_timings(self): # durations in seconds, first_* count from the last start or seek
+        timings = ffi.new("unsigned long long[7]")
+        Native.PlayerGetStartupTimings(self.cptr, timings)
+        names = ("open_input", "find_stream_info", "open_audio_decoder", "open_video_decoder", "open_decoders", "first_video_frame", "first_audio")
+        return { name: timings[i] / 1000000.0 for i, name in enumerate(names) }
+
+    def set_target_latency(self, latency): # seconds, live mode only
+        Native.PlayerSetTargetLatency(self.cptr, latency)
+
+    def get_target_latency(self):
+        return Native.PlayerGetTargetLatency(self.cptr)
+
+    def get_live_stats(self): # durations in seconds
+        stats = ffi.new("unsigned long long[4]")
+        Native.PlayerGetLiveStats(self.cptr, stats)
+        return { "latency": stats[0] / 1000000.0, "target_latency": stats[1] / 1000000.0, "catch_ups": stats[2], "dropped_duration": stats[3] / 1000000.0 }
+
 class LazyPlayer(VideoSource):
-    def __init__(self, filename):
-        self.cptr = Native.LazyPlayerCreate(filename.encode('mbcs'))
+    def __init__(self, filename, decoder_options = None):
+        self.cptr = Native.LazyPlayerCreate(filename.encode('mbcs'), _decoder_options_ptr(decoder_options))
         self.source_ptr = Native.LazyPlayerGetSourcePtr(self.cptr)
         VideoSource.__init__(self)
 
@@ -206,8 +305,8 @@ class CameraList(StringList):
         self.cptr = Native.CameraListCreate()
 
 class Camera:
-    def __init__(self, idx = 0):
-        self.cptr = Native.CameraCreate(idx)
+    def __init__(self, idx = 0, decoder_options = None):
+        self.cptr = Native.CameraCreate(idx, _decoder_options_ptr(decoder_options))
         self.targets = []
 
     def __del__(self):
@@ -20,6 +20,8 @@ int PullerWidth(void* ptr);
 int PullerHeight(void* ptr);
 int PullerIsFlipped(void* ptr);
 void PullerGetData(void* ptr, unsigned char* data);
+unsigned long long PullerPeekTimestamp(void* ptr);
+int PullerWait(void* ptr, int timeout_ms);
 
 void* PusherCreate(void* p_target);
 void PusherDestroy(void* ptr);
@@ -28,12 +30,22 @@ void PusherSetFlipped(void* ptr, int flipped);
 void PusherSetData(void* ptr, const unsigned char* data);
 void PusherPush(void* ptr);
 
-void* VideoPortCreate();
+void ImagePoolSetCapacity(unsigned long long capacity);
+void ImagePoolSetHugePages(int enable);
+void KeyframeIndexSetSidecar(int enable);
+
+void* DecoderOptionsCreate(int thread_count, int thread_type, int low_delay, int skip_frame, int skip_loop_filter, int skip_idct);
+void DecoderOptionsDestroy(void* ptr);
+void DecoderOptionsSet(void* ptr, const char* name, const char* value);
+
+void* VideoPortCreate(int depth, int lossless, int write_timeout_ms);
 void VideoPortDestroy(void* ptr);
 void* VideoPortGetSourcePtr(void* ptr);
 void* VideoPortGetTargetPtr(void* ptr);
+void VideoPortGetStats(void* ptr, unsigned long long* stats);
+void VideoPortResetStats(void* ptr);
 
-void* ImageFileCreate(const char* filename);
+void* ImageFileCreate(const char* filename, void* decoder_options);
 void ImageFileDestroy(void* ptr);
 void* ImageFileGetSourcePtr(void* ptr);
 int ImageFileWidth(void* ptr);
@@ -44,7 +56,7 @@ int GetDefaultAudioInputDeviceID();
 void* AudioOutputDeviceListCreate();
 int GetDefaultAudioOutputDeviceID();
 
-void* MediaInfoCreate(const char* fn);
+void* MediaInfoCreate(const char* fn, void* decoder_options);
 void MediaInfoDestroy(void* ptr);
 double MediaInfoGetDuration(void* ptr);
 int MediaInfoHasVideo(void* ptr);
@@ -57,7 +69,7 @@ int MediaInfoAudioSampleRate(void* ptr);
 int MediaInfoAudioNumberOfChannels(void* ptr);
 int MediaInfoAudioBitrate(void* ptr);
 
-void* PlayerCreate(const char* fn, int play_audio, int play_video, int audio_device_id);
+void* PlayerCreate(const char* fn, int play_audio, int play_video, int audio_device_id, int fast_start, int live, void* decoder_options);
 void PlayerDestroy(void* ptr);
 void PlayerAddTarget(void* ptr, void* p_target);
 int PlayerVideoWidth(void* ptr);
@@ -70,8 +82,23 @@ void PlayerStop(void* ptr);
 void PlayerStart(void* ptr);
 void PlayerSetPosition(void* ptr, double pos);
 void PlayerSetAudioDevice(void* ptr, int audio_device_id);
-
-void* LazyPlayerCreate(const char* fn);
+void PlayerGetQueueStats(void* ptr, int video, unsigned long long* stats);
+void PlayerGetAudioStats(void* ptr, unsigned long long* stats);
+void PlayerGetVideoStats(void* ptr, unsigned long long* stats);
+void PlayerSetRate(void* ptr, double rate, int stretch_audio);
+double PlayerGetRate(void* ptr);
+void PlayerSetFreeRun(void* ptr, int enable);
+int PlayerIsFreeRun(void* ptr);
+void PlayerAppend(void* ptr, const char* fn);
+void PlayerClearPlaylist(void* ptr);
+void PlayerSetLoop(void* ptr, int loop);
+int PlayerIsLooping(void* ptr);
+void PlayerGetStartupTimings(void* ptr, unsigned long long* timings);
+void PlayerSetTargetLatency(void* ptr, double latency);
+double PlayerGetTargetLatency(void* ptr);
+void PlayerGetLiveStats(void* ptr, unsigned long long* stats);
+
+void* LazyPlayerCreate(const char* fn, void* decoder_options);
 void LazyPlayerDestroy(void* ptr);
 void* LazyPlayerGetSourcePtr(void* ptr);
 int LazyPlayerVideoWidth(void* ptr);
@@ -86,7 +113,7 @@ void LazyPlayerSetPosition(void* ptr, double pos);
 
 void* CameraListCreate();
 
-void* CameraCreate(int idx);
+void* CameraCreate(int idx, void* decoder_options);
 void CameraDestroy(void* ptr);
 int CameraIdx(void* ptr);
 int CameraWidth(void* ptr);
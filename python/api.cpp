@@ -19,6 +19,8 @@ extern "C"
 	PY_LiveKit_API int PullerHeight(void* ptr);
 	PY_LiveKit_API int PullerIsFlipped(void* ptr);
 	PY_LiveKit_API void PullerGetData(void* ptr, unsigned char* data);
+	PY_LiveKit_API unsigned long long PullerPeekTimestamp(void* ptr);
+	PY_LiveKit_API int PullerWait(void* ptr, int timeout_ms);
 
 	PY_LiveKit_API void* PusherCreate(void* p_target);
 	PY_LiveKit_API void PusherDestroy(void* ptr);
@@ -27,12 +29,22 @@ extern "C"
 	PY_LiveKit_API void PusherSetData(void* ptr, const unsigned char* data);
 	PY_LiveKit_API void PusherPush(void* ptr);
 
-	PY_LiveKit_API void* VideoPortCreate();
+	PY_LiveKit_API void ImagePoolSetCapacity(unsigned long long capacity);
+	PY_LiveKit_API void ImagePoolSetHugePages(int enable);
+	PY_LiveKit_API void KeyframeIndexSetSidecar(int enable);
+
+	PY_LiveKit_API void* DecoderOptionsCreate(int thread_count, int thread_type, int low_delay, int skip_frame, int skip_loop_filter, int skip_idct);
+	PY_LiveKit_API void DecoderOptionsDestroy(void* ptr);
+	PY_LiveKit_API void DecoderOptionsSet(void* ptr, const char* name, const char* value);
+
+	PY_LiveKit_API void* VideoPortCreate(int depth, int lossless, int write_timeout_ms);
 	PY_LiveKit_API void VideoPortDestroy(void* ptr);
 	PY_LiveKit_API void* VideoPortGetSourcePtr(void* ptr);
 	PY_LiveKit_API void* VideoPortGetTargetPtr(void* ptr);
+	PY_LiveKit_API void VideoPortGetStats(void* ptr, unsigned long long* stats);
+	PY_LiveKit_API void VideoPortResetStats(void* ptr);
 
-	PY_LiveKit_API void* ImageFileCreate(const char* filename);
+	PY_LiveKit_API void* ImageFileCreate(const char* filename, void* decoder_options);
 	PY_LiveKit_API void ImageFileDestroy(void* ptr);
 	PY_LiveKit_API void* ImageFileGetSourcePtr(void* ptr);
 	PY_LiveKit_API int ImageFileWidth(void* ptr);
@@ -43,7 +55,7 @@ extern "C"
 	PY_LiveKit_API void* AudioOutputDeviceListCreate();
 	PY_LiveKit_API int GetDefaultAudioOutputDeviceID();
 
-	PY_LiveKit_API void* MediaInfoCreate(const char* fn);
+	PY_LiveKit_API void* MediaInfoCreate(const char* fn, void* decoder_options);
 	PY_LiveKit_API void MediaInfoDestroy(void* ptr);
 	PY_LiveKit_API double MediaInfoGetDuration(void* ptr);
 	PY_LiveKit_API int MediaInfoHasVideo(void* ptr);
@@ -56,7 +68,7 @@ extern "C"
 	PY_LiveKit_API int MediaInfoAudioNumberOfChannels(void* ptr);
 	PY_LiveKit_API int MediaInfoAudioBitrate(void* ptr);
 
-	PY_LiveKit_API void* PlayerCreate(const char* fn, int play_audio, int play_video, int audio_device_id);
+	PY_LiveKit_API void* PlayerCreate(const char* fn, int play_audio, int play_video, int audio_device_id, int fast_start, int live, void* decoder_options);
 	PY_LiveKit_API void PlayerDestroy(void* ptr);
 	PY_LiveKit_API void PlayerAddTarget(void* ptr, void* p_target);
 	PY_LiveKit_API int PlayerVideoWidth(void* ptr);
@@ -69,8 +81,23 @@ extern "C"
 	PY_LiveKit_API void PlayerStart(void* ptr);
 	PY_LiveKit_API void PlayerSetPosition(void* ptr, double pos);
 	PY_LiveKit_API void PlayerSetAudioDevice(void* ptr, int audio_device_id);
-
-	PY_LiveKit_API void* LazyPlayerCreate(const char* fn);
+	PY_LiveKit_API void PlayerGetQueueStats(void* ptr, int video, unsigned long long* stats);
+	PY_LiveKit_API void PlayerGetAudioStats(void* ptr, unsigned long long* stats);
+	PY_LiveKit_API void PlayerGetVideoStats(void* ptr, unsigned long long* stats);
+	PY_LiveKit_API void PlayerSetRate(void* ptr, double rate, int stretch_audio);
+	PY_LiveKit_API double PlayerGetRate(void* ptr);
+	PY_LiveKit_API void PlayerSetFreeRun(void* ptr, int enable);
+	PY_LiveKit_API int PlayerIsFreeRun(void* ptr);
+	PY_LiveKit_API void PlayerAppend(void* ptr, const char* fn);
+	PY_LiveKit_API void PlayerClearPlaylist(void* ptr);
+	PY_LiveKit_API void PlayerSetLoop(void* ptr, int loop);
+	PY_LiveKit_API int PlayerIsLooping(void* ptr);
+	PY_LiveKit_API void PlayerGetStartupTimings(void* ptr, unsigned long long* timings);
+	PY_LiveKit_API void PlayerSetTargetLatency(void* ptr, double latency);
+	PY_LiveKit_API double PlayerGetTargetLatency(void* ptr);
+	PY_LiveKit_API void PlayerGetLiveStats(void* ptr, unsigned long long* stats);
+
+	PY_LiveKit_API void* LazyPlayerCreate(const char* fn, void* decoder_options);
 	PY_LiveKit_API void LazyPlayerDestroy(void* ptr);
 	PY_LiveKit_API void* LazyPlayerGetSourcePtr(void* ptr);
 	PY_LiveKit_API int LazyPlayerVideoWidth(void* ptr);
@@ -85,7 +112,7 @@ extern "C"
 
 	PY_LiveKit_API void* CameraListCreate();
 
-	PY_LiveKit_API void* CameraCreate(int idx);
+	PY_LiveKit_API void* CameraCreate(int idx, void* decoder_options);
 	PY_LiveKit_API void CameraDestroy(void* ptr);
 	PY_LiveKit_API int CameraIdx(void* ptr);
 	PY_LiveKit_API int CameraWidth(void* ptr);
@@ -140,8 +167,13 @@ extern "C"
 
 #include <VideoPort.h>
 #include <Image.h>
+#include <ImagePool.h>
+#include <KeyframeIndex.h>
+#include <ImageConverter.h>
+#include <ImageCopy.h>
 #include <ImageFile.h>
 #include <Player.h>
+#include <PacketQueue.h>
 #include <LazyPlayer.h>
 #include <Camera.h>
 #include <Viewer.h>
@@ -181,33 +213,43 @@ class Puller
 public:
 	Puller(VideoSource *source) : m_source(source)
 	{
-
+		m_source->request_format(VideoFormatRequest(), this);
 	}
 
-	~Puller(){}
+	~Puller()
+	{
+		m_source->unlock_image(m_image);
+		m_source->cancel_format_request(this);
+	}
 
 	void pull()
 	{
-		m_image = m_source->read_image(&m_timestamp);
+		m_source->unlock_image(m_image);
+		m_image = m_source->lock_image(&m_timestamp);
+		m_packed = m_image != nullptr ? m_converter.to_packed(m_image) : nullptr;
 	}
 
 	uint64_t timestamp() const { return m_timestamp; }
-	bool has_alpha() const { return m_image->has_alpha(); }
-	int width() const { return m_image->width(); }
-	int height() const { return m_image->height(); }
-	bool is_flipped() const { return m_image->is_flipped(); }
+	uint64_t peek_timestamp() const { return m_source->peek_timestamp(); }
+	bool wait(int timeout_ms) const { return m_source->wait_image(m_timestamp, timeout_ms); }
+	bool has_alpha() const { return m_packed->has_alpha(); }
+	int width() const { return m_packed->width(); }
+	int height() const { return m_packed->height(); }
+	bool is_flipped() const { return m_packed->is_flipped(); }
 	void get_data(uint8_t* data) const
 	{
 		int width = this->width();
 		int height = this->height();
 		int chn = this->has_alpha() ? 4 : 3;
-		memcpy(data, m_image->data(), (size_t)width*height*chn);
+		copy_centered(m_packed->data(), width, height, m_packed->pixel_size(), m_packed->stride(), data, width, height, chn, width * chn, false);
 	}
 
 private:
 	VideoSource* m_source;
-	uint64_t m_timestamp;
+	uint64_t m_timestamp = (uint64_t)(-1);
 	const Image* m_image = nullptr;
+	const Image* m_packed = nullptr;
+	ImageConverter m_converter;
 };
 
 void* PullerCreate(void* p_source)
@@ -264,6 +306,18 @@ void PullerGetData(void* ptr, unsigned char* data)
 	puller->get_data(data);
 }
 
+unsigned long long PullerPeekTimestamp(void* ptr)
+{
+	Puller* puller = (Puller*)ptr;
+	return puller->peek_timestamp();
+}
+
+int PullerWait(void* ptr, int timeout_ms)
+{
+	Puller* puller = (Puller*)ptr;
+	return puller->wait(timeout_ms) ? 1 : 0;
+}
+
 class Pusher
 {
 public:
@@ -292,7 +346,7 @@ public:
 		int width = m_image->width();
 		int height = m_image->height();
 		int chn = m_image->has_alpha() ? 4 : 3;
-		memcpy(m_image->data(), data, (size_t)width*height*chn);
+		copy_centered(data, width, height, chn, width * chn, m_image->data(), width, height, chn, m_image->stride(), false);
 	}
 
 	void push() const
@@ -341,9 +395,55 @@ void PusherPush(void* ptr)
 	pusher->push();
 }
 
-void* VideoPortCreate()
+void ImagePoolSetCapacity(unsigned long long capacity)
+{
+	ImagePool::s_get_instance().set_capacity((size_t)capacity);
+}
+
+void ImagePoolSetHugePages(int enable)
+{
+	ImagePool::s_get_instance().set_huge_pages(enable != 0);
+}
+
+void KeyframeIndexSetSidecar(int enable)
+{
+	KeyframeIndex::s_set_sidecar(enable != 0);
+}
+
+void* DecoderOptionsCreate(int thread_count, int thread_type, int low_delay, int skip_frame, int skip_loop_filter, int skip_idct)
+{
+	DecoderOptions* options = new DecoderOptions;
+	options->thread_count = thread_count;
+	options->thread_type = (DecoderThreading)thread_type;
+	options->low_delay = low_delay != 0;
+	options->skip_frame = (DecoderSkip)skip_frame;
+	options->skip_loop_filter = (DecoderSkip)skip_loop_filter;
+	options->skip_idct = (DecoderSkip)skip_idct;
+	return options;
+}
+
+void DecoderOptionsDestroy(void* ptr)
 {
-	return new VideoPort;
+	DecoderOptions* options = (DecoderOptions*)ptr;
+	delete options;
+}
+
+void DecoderOptionsSet(void* ptr, const char* name, const char* value)
+{
+	DecoderOptions* options = (DecoderOptions*)ptr;
+	options->extra.push_back(std::make_pair(std::string(name), std::string(value)));
+}
+
+// the defaults when Python passes None
+static const DecoderOptions& s_decoder_options(void* ptr)
+{
+	static const DecoderOptions s_default;
+	return ptr != nullptr ? *(const DecoderOptions*)ptr : s_default;
+}
+
+void* VideoPortCreate(int depth, int lossless, int write_timeout_ms)
+{
+	return new VideoPort(depth, lossless != 0 ? VideoPort::Mode::Lossless : VideoPort::Mode::Latest, write_timeout_ms);
 }
 
 void VideoPortDestroy(void* ptr)
@@ -364,10 +464,26 @@ void* VideoPortGetTargetPtr(void* ptr)
 	return (VideoTarget*)port;
 }
 
+void VideoPortGetStats(void* ptr, unsigned long long* stats)
+{
+	VideoPort* port = (VideoPort*)ptr;
+	VideoPortStats s = port->get_stats();
+	stats[0] = s.frames_written;
+	stats[1] = s.frames_read;
+	stats[2] = s.frames_overwritten;
+	stats[3] = s.frames_dropped;
+}
+
+void VideoPortResetStats(void* ptr)
+{
+	VideoPort* port = (VideoPort*)ptr;
+	port->reset_stats();
+}
+
 
-void* ImageFileCreate(const char* filename)
+void* ImageFileCreate(const char* filename, void* decoder_options)
 {
-	return new ImageFile(filename);
+	return new ImageFile(filename, s_decoder_options(decoder_options));
 }
 
 void ImageFileDestroy(void* ptr)
@@ -423,10 +539,10 @@ int GetDefaultAudioOutputDeviceID()
 	return id_default;
 }
 
-void* MediaInfoCreate(const char* fn)
+void* MediaInfoCreate(const char* fn, void* decoder_options)
 {
 	MediaInfo* info = new MediaInfo;
-	get_media_info(fn, info);
+	get_media_info(fn, info, s_decoder_options(decoder_options));
 	return info;
 }
 
@@ -498,9 +614,9 @@ int MediaInfoAudioBitrate(void* ptr)
 	return info->audio_bitrate;
 }
 
-void* PlayerCreate(const char* fn, int play_audio, int play_video, int audio_device_id)
+void* PlayerCreate(const char* fn, int play_audio, int play_video, int audio_device_id, int fast_start, int live, void* decoder_options)
 {
-	return new Player(fn, play_audio != 0, play_video != 0, audio_device_id);
+	return new Player(fn, play_audio != 0, play_video != 0, audio_device_id, fast_start != 0, live != 0, s_decoder_options(decoder_options));
 }
 
 void PlayerDestroy(void* ptr)
@@ -577,9 +693,130 @@ void PlayerSetAudioDevice(void* ptr, int audio_device_id)
 	player->set_audio_device(audio_device_id);
 }
 
-void* LazyPlayerCreate(const char* fn)
+void PlayerGetQueueStats(void* ptr, int video, unsigned long long* stats)
+{
+	Player* player = (Player*)ptr;
+	PacketQueueStats audio_stats, video_stats;
+	player->get_queue_stats(&audio_stats, &video_stats);
+	const PacketQueueStats& s = video != 0 ? video_stats : audio_stats;
+	stats[0] = s.packets;
+	stats[1] = s.bytes;
+	stats[2] = s.duration;
+	stats[3] = s.target_duration;
+	stats[4] = s.underruns;
+}
+
+void PlayerGetAudioStats(void* ptr, unsigned long long* stats)
+{
+	Player* player = (Player*)ptr;
+	AudioPlaybackStats s;
+	player->get_audio_stats(&s);
+	stats[0] = s.underruns;
+	stats[1] = s.underrun_samples;
+	stats[2] = s.buffered_samples;
+	stats[3] = s.capacity_samples;
+}
+
+void PlayerGetVideoStats(void* ptr, unsigned long long* stats)
+{
+	Player* player = (Player*)ptr;
+	VideoPlaybackStats s;
+	player->get_video_stats(&s);
+	stats[0] = s.shed_decode;
+	stats[1] = s.shed_convert;
+	stats[2] = s.shed_present;
+	stats[3] = s.shed_level;
+	stats[4] = s.shedding_time;
+}
+
+void PlayerSetRate(void* ptr, double rate, int stretch_audio)
+{
+	Player* player = (Player*)ptr;
+	player->set_rate(rate, stretch_audio != 0);
+}
+
+double PlayerGetRate(void* ptr)
+{
+	Player* player = (Player*)ptr;
+	return player->get_rate();
+}
+
+void PlayerSetFreeRun(void* ptr, int enable)
+{
+	Player* player = (Player*)ptr;
+	player->set_free_run(enable != 0);
+}
+
+int PlayerIsFreeRun(void* ptr)
+{
+	Player* player = (Player*)ptr;
+	return player->is_free_run() ? 1 : 0;
+}
+
+void PlayerAppend(void* ptr, const char* fn)
+{
+	Player* player = (Player*)ptr;
+	player->append(fn);
+}
+
+void PlayerClearPlaylist(void* ptr)
+{
+	Player* player = (Player*)ptr;
+	player->clear_playlist();
+}
+
+void PlayerSetLoop(void* ptr, int loop)
+{
+	Player* player = (Player*)ptr;
+	player->set_loop(loop != 0);
+}
+
+int PlayerIsLooping(void* ptr)
+{
+	Player* player = (Player*)ptr;
+	return player->is_looping() ? 1 : 0;
+}
+
+void PlayerGetStartupTimings(void* ptr, unsigned long long* timings)
+{
+	Player* player = (Player*)ptr;
+	StartupTimings t;
+	player->get_startup_timings(&t);
+	timings[0] = t.open_input;
+	timings[1] = t.find_stream_info;
+	timings[2] = t.open_audio_decoder;
+	timings[3] = t.open_video_decoder;
+	timings[4] = t.open_decoders;
+	timings[5] = t.first_video_frame;
+	timings[6] = t.first_audio;
+}
+
+void PlayerSetTargetLatency(void* ptr, double latency)
+{
+	Player* player = (Player*)ptr;
+	player->set_target_latency((uint64_t)(latency*1000000.0));
+}
+
+double PlayerGetTargetLatency(void* ptr)
+{
+	Player* player = (Player*)ptr;
+	return (double)player->get_target_latency() / 1000000.0;
+}
+
+void PlayerGetLiveStats(void* ptr, unsigned long long* stats)
+{
+	Player* player = (Player*)ptr;
+	LiveStats s;
+	player->get_live_stats(&s);
+	stats[0] = s.latency;
+	stats[1] = s.target_latency;
+	stats[2] = s.catch_ups;
+	stats[3] = s.dropped_duration;
+}
+
+void* LazyPlayerCreate(const char* fn, void* decoder_options)
 {
-	return new LazyPlayer(fn);
+	return new LazyPlayer(fn, s_decoder_options(decoder_options));
 }
 
 void LazyPlayerDestroy(void* ptr)
@@ -655,9 +892,9 @@ void* CameraListCreate()
 	return lst;
 }
 
-void* CameraCreate(int idx)
+void* CameraCreate(int idx, void* decoder_options)
 {
-	return new Camera(idx);
+	return new Camera(idx, s_decoder_options(decoder_options));
 }
 
 void CameraDestroy(void* ptr)
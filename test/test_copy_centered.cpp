@@ -0,0 +1,116 @@
+#include <stdio.h>
+#include <string.h>
+#include <ImageCopy.h>
+using namespace LiveKit;
+
+#include <random>
+#include <vector>
+
+// Compares copy_centered at every SIMD level the CPU supports against the straightforward scalar version
+// it replaced, on random sizes, channel counts, strides and flips. Output rows start out as garbage, and a
+// guard area after the output buffer catches vector stores that run past the end of the last row.
+
+static void copy_centered_ref(const uint8_t* data_in, int width_in, int height_in, int chn_in, int stride_in,
+	uint8_t* data_out, int width_out, int height_out, int chn_out, int stride_out, bool flip)
+{
+	for (int y = 0; y < height_out; y++)
+		memset(data_out + (size_t)y * stride_out, 0, (size_t)width_out * chn_out);
+
+	int offset_in_x = 0;
+	int offset_in_y = 0;
+	int offset_out_x = 0;
+	int offset_out_y = 0;
+	int scan_w = width_out < width_in ? width_out : width_in;
+	int scan_h = height_out < height_in ? height_out : height_in;
+
+	if (width_in < width_out)
+		offset_out_x = (width_out - width_in) / 2;
+	else if (width_in > width_out)
+		offset_in_x = (width_in - width_out) / 2;
+
+	if (height_in < height_out)
+		offset_out_y = (height_out - height_in) / 2;
+	else if (height_in > height_out)
+		offset_in_y = (height_in - height_out) / 2;
+
+	for (int y = 0; y < scan_h; y++)
+	{
+		int y2 = flip ? (scan_h - 1) - y : y;
+		const uint8_t* p_in_line = data_in + (size_t)(y2 + offset_in_y) * stride_in;
+		uint8_t* p_out_line = data_out + (size_t)(y + offset_out_y) * stride_out;
+		for (int x = 0; x < scan_w; x++)
+		{
+			const uint8_t* p_in = p_in_line + (x + offset_in_x) * chn_in;
+			uint8_t* p_out = p_out_line + (x + offset_out_x) * chn_out;
+			int c = 0;
+			for (; c < chn_in && c < chn_out; c++)
+				p_out[c] = p_in[c];
+			for (; c < chn_out; c++)
+				p_out[c] = 255;
+		}
+	}
+}
+
+static const int s_num_cases = 3000;
+static const int s_guard_size = 64;
+
+int main()
+{
+	std::mt19937 rng(12345);
+	auto rand_int = [&rng](int lo, int hi) { return std::uniform_int_distribution<int>(lo, hi)(rng); };
+
+	size_t failures = 0;
+	int max_level = (int)max_simd_level();
+	for (int level = 0; level <= max_level; level++)
+	{
+		set_simd_level((SimdLevel)level);
+		size_t level_failures = 0;
+		for (int i = 0; i < s_num_cases; i++)
+		{
+			int width_in = rand_int(1, 300);
+			int height_in = rand_int(1, 64);
+			int chn_in = rand_int(3, 4);
+			int stride_in = width_in * chn_in + rand_int(0, 1) * rand_int(0, 40);
+			int width_out = rand_int(0, 3) == 0 ? width_in : rand_int(1, 300);
+			int height_out = rand_int(0, 3) == 0 ? height_in : rand_int(1, 64);
+			int chn_out = rand_int(3, 4);
+			int stride_out = width_out * chn_out + rand_int(0, 1) * rand_int(0, 40);
+			bool flip = rand_int(0, 1) != 0;
+
+			std::vector<uint8_t> in((size_t)stride_in * height_in);
+			for (size_t j = 0; j < in.size(); j++)
+				in[j] = (uint8_t)rng();
+
+			size_t out_size = (size_t)stride_out * height_out;
+			std::vector<uint8_t> out(out_size + s_guard_size);
+			for (size_t j = 0; j < out.size(); j++)
+				out[j] = (uint8_t)rng();
+			std::vector<uint8_t> expected = out;
+
+			copy_centered(in.data(), width_in, height_in, chn_in, stride_in, out.data(), width_out, height_out, chn_out, stride_out, flip);
+			copy_centered_ref(in.data(), width_in, height_in, chn_in, stride_in, expected.data(), width_out, height_out, chn_out, stride_out, flip);
+
+			bool match = memcmp(out.data() + out_size, expected.data() + out_size, s_guard_size) == 0;
+			for (int y = 0; y < height_out && match; y++)
+				match = memcmp(out.data() + (size_t)y * stride_out, expected.data() + (size_t)y * stride_out, (size_t)width_out * chn_out) == 0;
+
+			if (!match)
+			{
+				if (level_failures < 10)
+					printf("mismatch at level %d: %dx%dx%d (stride %d) -> %dx%dx%d (stride %d), flip %d\n", level,
+						width_in, height_in, chn_in, stride_in, width_out, height_out, chn_out, stride_out, flip ? 1 : 0);
+				level_failures++;
+			}
+		}
+		printf("simd level %d: %d cases, %zu mismatches\n", level, s_num_cases, level_failures);
+		failures += level_failures;
+	}
+
+	if (failures > 0)
+	{
+		printf("FAILED\n");
+		return 1;
+	}
+	printf("PASSED\n");
+	return 0;
+}
@@ -0,0 +1,77 @@
+#include <stdio.h>
+#include <FramePacer.h>
+#include <Utils.h>
+using namespace LiveKit;
+
+#include <thread>
+#include <chrono>
+
+// Paces 2 seconds of 60 fps frames on an absolute schedule and checks the wake-up jitter,
+// then checks that deadlines already behind us are reported as missed, and that interrupt()
+// cuts a long wait short without counting it.
+
+static const int s_num_frames = 120;
+static const uint64_t s_frame_interval = 1000000 / 60;
+
+int main()
+{
+	bool ok = true;
+
+	FramePacer pacer;
+	uint64_t start = time_micro_sec();
+	for (int i = 1; i <= s_num_frames; i++)
+		pacer.wait_until(start + i * s_frame_interval);
+
+	PacingStats stats = pacer.get_stats();
+	printf("%d frames: mean lateness %.1f us, max %llu us, %llu missed\n", s_num_frames,
+		(double)stats.total_lateness / (double)stats.deadlines, (unsigned long long)stats.max_lateness, (unsigned long long)stats.missed);
+
+	if (stats.deadlines != s_num_frames)
+	{
+		printf("expected %d deadlines, got %llu\n", s_num_frames, (unsigned long long)stats.deadlines);
+		ok = false;
+	}
+	// a loaded machine can miss a few, but the typical frame must be well within a millisecond
+	if (stats.total_lateness / stats.deadlines > 500 || stats.missed > s_num_frames / 10)
+	{
+		printf("pacing too imprecise\n");
+		ok = false;
+	}
+
+	pacer.reset_stats();
+	if (pacer.wait_until(time_micro_sec() - 10000))
+	{
+		printf("past deadline not reported as missed\n");
+		ok = false;
+	}
+	stats = pacer.get_stats();
+	if (stats.deadlines != 1 || stats.missed != 1 || stats.max_lateness < 10000)
+	{
+		printf("unexpected stats after a missed deadline\n");
+		ok = false;
+	}
+
+	pacer.reset_stats();
+	uint64_t wait_start = time_micro_sec();
+	std::thread interrupter([&pacer]()
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		pacer.interrupt();
+	});
+	pacer.wait_until(wait_start + 5000000);
+	interrupter.join();
+	uint64_t waited = time_micro_sec() - wait_start;
+	if (waited > 1000000 || pacer.get_stats().deadlines != 0)
+	{
+		printf("interrupted wait took %llu us\n", (unsigned long long)waited);
+		ok = false;
+	}
+
+	if (!ok)
+	{
+		printf("FAILED\n");
+		return 1;
+	}
+	printf("PASSED\n");
+	return 0;
+}
@@ -0,0 +1,236 @@
+#include <stdio.h>
+#include <PacketQueue.h>
+using namespace LiveKit;
+
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <memory>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <time.h>
+#endif
+
+// Consumers of PacketQueue model Player threads waiting on a stalled source. While nothing arrives
+// they must sleep, so the process should use next to no CPU time. Then checks that blocked calls
+// return on delivery, at EOF and when their 'running' flag is cleared, and streams packets through
+// a small ring so that both the full and the empty waits are exercised. Finally checks the byte and
+// duration budgets and that running dry deepens the read-ahead.
+
+static const int s_num_players = 8;
+static const int s_stall_ms = 1000;
+static const int s_num_packets = 200000;
+
+static double s_cpu_time()
+{
+#ifdef _WIN32
+	FILETIME creation, exit, kernel, user;
+	GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user);
+	uint64_t t_kernel = ((uint64_t)kernel.dwHighDateTime << 32) | kernel.dwLowDateTime;
+	uint64_t t_user = ((uint64_t)user.dwHighDateTime << 32) | user.dwLowDateTime;
+	return (double)(t_kernel + t_user) / 10000000.0;
+#else
+	timespec ts;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1000000000.0;
+#endif
+}
+
+// packets are timed in milliseconds
+static const size_t s_max_bytes = 1 << 20;
+static const int s_time_base_den = 1000;
+
+static void s_push(PacketQueue& queue, int64_t dts, const std::atomic<bool>& running, int size = 0)
+{
+	AVPacket packet;
+	av_init_packet(&packet);
+	packet.data = nullptr;
+	packet.size = size;
+	packet.dts = dts;
+	queue.Push(&packet, running);
+}
+
+static bool s_check_budget(PacketQueue& queue, int size, int64_t dts_step, size_t expected_packets, const char* name)
+{
+	std::atomic<bool> running(true);
+	std::thread producer([&]()
+	{
+		for (int i = 0; i < 100; i++)
+			s_push(queue, i * dts_step, running, size);
+	});
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	PacketQueueStats stats = queue.GetStats();
+	running = false;
+	queue.Wake();
+	producer.join();
+	queue.Clear();
+
+	printf("%s: %zu packets, %zu bytes, %.3f s queued\n", name, stats.packets, stats.bytes, (double)stats.duration / 1000000.0);
+	if (stats.packets != expected_packets)
+	{
+		printf("expected %zu packets\n", expected_packets);
+		return false;
+	}
+	return true;
+}
+
+int main()
+{
+	bool ok = true;
+
+	// audio and video queue of every player, with one consumer each
+	std::vector<std::unique_ptr<PacketQueue>> queues;
+	std::vector<int64_t> received(s_num_players * 2, -1);
+	std::vector<std::thread> consumers;
+	std::atomic<bool> running(true);
+	for (int i = 0; i < s_num_players * 2; i++)
+		queues.push_back(std::unique_ptr<PacketQueue>(new PacketQueue(s_max_bytes, 1, s_time_base_den)));
+
+	double cpu_start = s_cpu_time();
+	for (int i = 0; i < s_num_players * 2; i++)
+	{
+		consumers.push_back(std::thread([&queues, &received, &running, i]()
+		{
+			AVPacket packet;
+			if (i % 2 == 0)
+			{
+				// video style: wait for the next packet, then take it
+				if (queues[i]->Peek(running) == nullptr) return;
+			}
+			if (queues[i]->Pop(&packet, running))
+				received[i] = packet.dts;
+		}));
+	}
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(s_stall_ms));
+	double cpu_used = s_cpu_time() - cpu_start;
+	printf("%d blocked consumers used %.1f ms of CPU time in %d ms\n", s_num_players * 2, cpu_used * 1000.0, s_stall_ms);
+	if (cpu_used > 0.05)
+	{
+		printf("consumers are spinning\n");
+		ok = false;
+	}
+
+	for (int i = 0; i < s_num_players * 2; i++)
+		s_push(*queues[i], i, running);
+	for (size_t i = 0; i < consumers.size(); i++)
+		consumers[i].join();
+	consumers.clear();
+	for (int i = 0; i < s_num_players * 2; i++)
+	{
+		if (received[i] != i)
+		{
+			printf("consumer %d received %lld\n", i, (long long)received[i]);
+			ok = false;
+		}
+	}
+
+	// EOF: queued packets are still delivered, then consumers are released
+	PacketQueue& queue = *queues[0];
+	s_push(queue, 100, running);
+	queue.SetEOF();
+	AVPacket packet;
+	if (!queue.Pop(&packet, running) || packet.dts != 100)
+	{
+		printf("packet queued before EOF was lost\n");
+		ok = false;
+	}
+	if (queue.Pop(&packet, running) || queue.Peek(running) != nullptr)
+	{
+		printf("wait did not end at EOF\n");
+		ok = false;
+	}
+	queue.Clear();
+
+	// streaming in order through a ring of 4, the consumer occasionally lags behind
+	{
+		PacketQueue ring(s_max_bytes, 1, s_time_base_den, 4);
+		int64_t expected = 0;
+		std::thread producer([&]()
+		{
+			for (int i = 0; i < s_num_packets; i++)
+				s_push(ring, i, running);
+			ring.SetEOF();
+		});
+		AVPacket received_packet;
+		while (ring.Pop(&received_packet, running))
+		{
+			if (received_packet.dts != expected) break;
+			expected++;
+			if (expected % 10000 == 0)
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		producer.join();
+		printf("streamed %lld of %d packets\n", (long long)expected, s_num_packets);
+		if (expected != s_num_packets)
+		{
+			printf("packets lost or out of order\n");
+			ok = false;
+		}
+	}
+
+	// stopping: a blocked consumer and a producer blocked on a full queue both give up
+	PacketQueue small_queue(s_max_bytes, 1, s_time_base_den, 1);
+	s_push(small_queue, 0, running);
+	bool pushed = true;
+	bool popped = true;
+	std::thread producer([&]()
+	{
+		AVPacket extra;
+		av_init_packet(&extra);
+		extra.data = nullptr;
+		extra.size = 0;
+		pushed = small_queue.Push(&extra, running);
+	});
+	std::thread consumer([&]() { popped = queue.Pop(&packet, running); });
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	running = false;
+	small_queue.Wake();
+	queue.Wake();
+	producer.join();
+	consumer.join();
+	if (pushed || popped)
+	{
+		printf("blocked calls did not return on stop\n");
+		ok = false;
+	}
+
+	// budgets: 4 packets of 300 bytes exceed 1000 bytes, 11 packets 100ms apart span the initial 1s read-ahead
+	{
+		PacketQueue bytes_queue(1000, 1, s_time_base_den);
+		ok = s_check_budget(bytes_queue, 300, 1, 4, "byte budget") && ok;
+
+		PacketQueue duration_queue(s_max_bytes, 1, s_time_base_den);
+		ok = s_check_budget(duration_queue, 1, 100, (size_t)(PacketQueue::s_initial_read_ahead / 100000 + 1), "duration budget") && ok;
+
+		// running dry after the first packet doubles the read-ahead
+		running = true;
+		s_push(duration_queue, 0, running);
+		duration_queue.Pop(&packet, running);
+		std::thread late_producer([&]()
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+			s_push(duration_queue, 100, running);
+		});
+		duration_queue.Pop(&packet, running);
+		late_producer.join();
+		PacketQueueStats stats = duration_queue.GetStats();
+		printf("after underrun: %llu underruns, read-ahead %.3f s\n", (unsigned long long)stats.underruns, (double)stats.target_duration / 1000000.0);
+		if (stats.underruns != 1 || stats.target_duration != PacketQueue::s_initial_read_ahead * 2)
+		{
+			printf("underrun did not deepen the read-ahead\n");
+			ok = false;
+		}
+	}
+
+	if (!ok)
+	{
+		printf("FAILED\n");
+		return 1;
+	}
+	printf("PASSED\n");
+	return 0;
+}
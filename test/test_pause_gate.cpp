@@ -0,0 +1,87 @@
+#include <stdio.h>
+#include <PauseGate.h>
+#include <StageQueue.h>
+using namespace LiveKit;
+
+#include <thread>
+#include <atomic>
+#include <vector>
+
+// PauseGate lets Player reposition a running pipeline without re-creating its threads. A producer and
+// a consumer pass numbers through a StageQueue; the controller repeatedly stops the run, checks that
+// both threads are parked, restarts the numbering from a new base and releases them. Every number a
+// consumer sees must belong to the run it was produced in. Finally Close() lets the threads exit.
+
+static const int s_num_runs = 50;
+static const int s_items_per_run = 1000;
+
+int main()
+{
+	bool passed = true;
+
+	PauseGate gate(2);
+	StageQueue<int> queue(8);
+	std::atomic<bool> running(true);
+	int base = 0; // changed only while both threads are parked
+	std::atomic<int> consumed(0);
+	std::atomic<int> mismatches(0);
+
+	std::thread producer([&]()
+	{
+		do
+		{
+			for (int i = 0; i < s_items_per_run; i++)
+				if (!queue.Push(base + i, running)) break;
+		} while (gate.Park());
+	});
+
+	std::thread consumer([&]()
+	{
+		do
+		{
+			int item;
+			while (queue.Pop(&item, running))
+			{
+				if (item < base || item >= base + s_items_per_run) mismatches++;
+				consumed++;
+			}
+		} while (gate.Park());
+	});
+
+	for (int run = 1; run <= s_num_runs; run++)
+	{
+		std::this_thread::sleep_for(std::chrono::microseconds(200));
+
+		running = false;
+		queue.Wake();
+		gate.WaitParked();
+
+		queue.Clear();
+		base = run * s_items_per_run;
+		running = true;
+		gate.Release();
+	}
+
+	running = false;
+	queue.Wake();
+	gate.Close();
+	producer.join();
+	consumer.join();
+
+	printf("%d runs, %d items consumed, %d from a stale run\n", s_num_runs, (int)consumed, (int)mismatches);
+	if (mismatches > 0)
+		passed = false;
+	if (consumed == 0)
+	{
+		printf("nothing got through\n");
+		passed = false;
+	}
+
+	if (!passed)
+	{
+		printf("FAILED\n");
+		return 1;
+	}
+	printf("PASSED\n");
+	return 0;
+}
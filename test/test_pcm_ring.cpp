@@ -0,0 +1,113 @@
+#include <stdio.h>
+#include <PcmRing.h>
+using namespace LiveKit;
+
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <cstdlib>
+
+// PcmRing sits between Player's audio decoder and the device callback. Streams numbered samples in
+// decoder-sized chunks to a reader taking device-sized blocks, checking order and the media time
+// reported for each block. Then checks that a blocked writer is released by Wake() when stopped.
+
+static const int s_samplerate = 48000;
+static const size_t s_capacity = 4800;
+static const size_t s_chunk = 1024;
+static const size_t s_total = 48000 * 20;
+
+int main()
+{
+	bool passed = true;
+
+	// continuous stream starting at 5s
+	{
+		PcmRing ring(s_capacity, s_samplerate);
+		std::atomic<bool> running(true);
+		const int64_t t0 = 5000000;
+
+		std::thread producer([&]()
+		{
+			std::vector<short> chunk(s_chunk * 2);
+			for (size_t pos = 0; pos < s_total; )
+			{
+				size_t size = s_chunk;
+				if (size > s_total - pos) size = s_total - pos;
+				for (size_t i = 0; i < size; i++)
+				{
+					chunk[i * 2] = (short)((pos + i) & 0x7fff);
+					chunk[i * 2 + 1] = (short)(-(short)((pos + i) & 0x7fff));
+				}
+				int64_t end_time = t0 + (int64_t)(pos + size) * 1000000 / s_samplerate;
+				size_t written = 0;
+				while (written < size)
+				{
+					if (!ring.WaitSpace(size - written, running)) return;
+					written += ring.Write(chunk.data() + written * 2, size - written, end_time);
+				}
+				pos += size;
+			}
+			ring.SetEOF();
+		});
+
+		std::vector<short> block(960 * 2);
+		size_t expected = 0;
+		int empty_reads = 0;
+		int bad_samples = 0;
+		int bad_times = 0;
+		while (true)
+		{
+			size_t size = 64 + rand() % 897;
+			uint64_t position = ring.ReadPosition();
+			size_t count = ring.Read(block.data(), size);
+			if (count == 0)
+			{
+				if (ring.IsEOF() && ring.Available() == 0) break;
+				empty_reads++;
+				std::this_thread::yield();
+				continue;
+			}
+			for (size_t i = 0; i < count; i++, expected++)
+			{
+				if (block[i * 2] != (short)(expected & 0x7fff) || block[i * 2 + 1] != (short)(-(short)(expected & 0x7fff)))
+					bad_samples++;
+			}
+			int64_t t = ring.TimeAt(position);
+			int64_t t_expected = t0 + (int64_t)position * 1000000 / s_samplerate;
+			if (t < t_expected - 1 || t > t_expected + 1)
+				bad_times++;
+		}
+		producer.join();
+
+		printf("stream: %zu samples, %d bad samples, %d bad times, %d empty reads\n", expected, bad_samples, bad_times, empty_reads);
+		if (expected != s_total || bad_samples > 0 || bad_times > 0) passed = false;
+	}
+
+	// a writer waiting on a full ring returns when stopped
+	{
+		PcmRing ring(s_capacity, s_samplerate);
+		std::atomic<bool> running(true);
+		std::vector<short> chunk(s_capacity * 2, 0);
+		ring.Write(chunk.data(), s_capacity, -1);
+
+		bool result = true;
+		std::thread producer([&]()
+		{
+			result = ring.WaitSpace(s_chunk, running);
+		});
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		running = false;
+		ring.Wake();
+		producer.join();
+
+		printf("stopped writer: %s\n", result ? "still waiting" : "released");
+		if (result) passed = false;
+
+		ring.Clear();
+		if (ring.Available() != 0 || ring.TimeAt(ring.ReadPosition()) != -1) passed = false;
+	}
+
+	printf(passed ? "PASSED\n" : "FAILED\n");
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,100 @@
+#include <stdio.h>
+#include <SliceScaler.h>
+#include <WorkerPool.h>
+using namespace LiveKit;
+
+extern "C" {
+#include <libavutil/imgutils.h>
+#include <libavutil/mem.h>
+#include <libswscale/swscale.h>
+}
+
+#include <cstdlib>
+
+// SliceScaler converts horizontal slices of a frame in parallel. Chroma filters reach across slice
+// boundaries, so a sliced conversion must come out exactly like a single sws_scale() pass, in both
+// directions the library uses: decoded YUV to BGR and captured BGR to the encoder's YUV420P.
+
+struct Conversion
+{
+	AVPixelFormat src;
+	AVPixelFormat dst;
+	int flags;
+};
+
+static const Conversion s_conversions[] =
+{
+	{ AV_PIX_FMT_YUV420P, AV_PIX_FMT_BGR0, SWS_BICUBIC },
+	{ AV_PIX_FMT_NV12, AV_PIX_FMT_BGR0, SWS_BICUBIC },
+	{ AV_PIX_FMT_BGR0, AV_PIX_FMT_YUV420P, SWS_BILINEAR },
+	{ AV_PIX_FMT_BGRA, AV_PIX_FMT_YUV420P, SWS_BICUBIC },
+	{ AV_PIX_FMT_BGR24, AV_PIX_FMT_BGR0, SWS_BICUBIC }
+};
+
+static const int s_sizes[][2] = { { 1920, 1080 }, { 1366, 768 }, { 640, 361 } };
+
+static bool s_compare(WorkerPool& pool, const Conversion& c, int width, int height)
+{
+	uint8_t* src[4];
+	int src_linesize[4];
+	uint8_t* single[4];
+	uint8_t* sliced[4];
+	int dst_linesize[4];
+	av_image_alloc(src, src_linesize, width, height, c.src, 32);
+	av_image_alloc(single, dst_linesize, width, height, c.dst, 32);
+	av_image_alloc(sliced, dst_linesize, width, height, c.dst, 32);
+
+	// sharp edges everywhere, so that any filter that stops at a slice boundary shows
+	int size = av_image_get_buffer_size(c.src, width, height, 32);
+	srand(1);
+	for (int i = 0; i < size; i++)
+		src[0][i] = (uint8_t)(rand() & 1 ? 228 : 28);
+
+	SwsContext* ctx = sws_getContext(width, height, c.src, width, height, c.dst, c.flags, nullptr, nullptr, nullptr);
+	sws_scale(ctx, src, src_linesize, 0, height, single, dst_linesize);
+	sws_freeContext(ctx);
+
+	SliceScaler scaler(c.flags, &pool);
+	scaler.scale(src, src_linesize, width, height, c.src, sliced, dst_linesize, width, height, c.dst);
+
+	int differ = 0;
+	int first_row = -1;
+	int num_planes = av_pix_fmt_count_planes(c.dst);
+	const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(c.dst);
+	for (int i = 0; i < num_planes; i++)
+	{
+		int row_size = av_image_get_linesize(c.dst, width, i);
+		int rows = (i == 1 || i == 2) ? -((-height) >> desc->log2_chroma_h) : height;
+		for (int y = 0; y < rows; y++)
+		{
+			const uint8_t* a = single[i] + (size_t)y * dst_linesize[i];
+			const uint8_t* b = sliced[i] + (size_t)y * dst_linesize[i];
+			for (int x = 0; x < row_size; x++)
+			{
+				if (a[x] == b[x]) continue;
+				if (differ++ == 0) first_row = y;
+			}
+		}
+	}
+
+	printf("%s -> %s %dx%d, %d slices: %d bytes differ", av_get_pix_fmt_name(c.src), av_get_pix_fmt_name(c.dst), width, height, scaler.num_slices(), differ);
+	if (differ > 0) printf(", first in row %d", first_row);
+	printf("\n");
+
+	av_freep(&src[0]);
+	av_freep(&single[0]);
+	av_freep(&sliced[0]);
+	return differ == 0;
+}
+
+int main()
+{
+	bool passed = true;
+	WorkerPool pool(3);
+	for (const Conversion& c : s_conversions)
+		for (const auto& size : s_sizes)
+			passed = s_compare(pool, c, size[0], size[1]) && passed;
+
+	printf(passed ? "PASSED\n" : "FAILED\n");
+	return passed ? 0 : 1;
+}
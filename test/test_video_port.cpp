@@ -0,0 +1,210 @@
+#include <stdio.h>
+#include <string.h>
+#include <VideoPort.h>
+#include <Image.h>
+#include <ImageRecycler.h>
+using namespace LiveKit;
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <chrono>
+
+// One writer and several readers hammer a VideoPort. Every frame the writer produces is filled with a single byte value,
+// so a reader sees a torn frame whenever the bytes of a pinned image are not all the same.
+// Readers block in wait_image(), so each frame they lock must be newer than the previous one.
+
+static const int s_width = 640;
+static const int s_height = 360;
+static const int s_num_readers = 8;
+static const int s_duration_ms = 3000;
+static const int s_lossless_frames = 2000;
+
+static bool test_latest()
+{
+	VideoPort port;
+	std::atomic<bool> running(true);
+	std::atomic<size_t> frames_written(0);
+	std::atomic<size_t> frames_read(0);
+	std::atomic<size_t> frames_torn(0);
+	std::atomic<size_t> frames_stale(0);
+
+	// even frames are deep-copied into the port, odd frames are passed by reference from recycled buffers
+	std::thread writer([&]()
+	{
+		Image img(s_width, s_height);
+		ImageRecycler recycler;
+		size_t size = (size_t)Image::s_default_stride(s_width, PixelFormat::BGR24) * s_height;
+		uint8_t value = 0;
+		while (running)
+		{
+			if (value % 2 == 0)
+			{
+				memset(img.data(), value, size);
+				port.write_image(&img);
+			}
+			else
+			{
+				std::shared_ptr<Image> buf = recycler.get(s_width, s_height);
+				memset(buf->data(), value, size);
+				ImageRef frame = buf;
+				port.write_image(frame);
+			}
+			value++;
+			frames_written++;
+		}
+	});
+
+	std::vector<std::thread> readers;
+	for (int i = 0; i < s_num_readers; i++)
+	{
+		readers.push_back(std::thread([&]()
+		{
+			size_t size = (size_t)Image::s_default_stride(s_width, PixelFormat::BGR24) * s_height;
+			uint64_t last_timestamp = (uint64_t)(-1);
+			while (running)
+			{
+				if (!port.wait_image(last_timestamp, 100)) continue;
+				uint64_t timestamp;
+				const Image* img = port.lock_image(&timestamp);
+				if (last_timestamp != (uint64_t)(-1) && timestamp <= last_timestamp)
+					frames_stale++;
+				last_timestamp = timestamp;
+				if (timestamp != (uint64_t)(-1))
+				{
+					const uint8_t* data = img->data();
+					uint8_t first = data[0];
+					for (size_t j = 1; j < size; j++)
+					{
+						if (data[j] != first)
+						{
+							frames_torn++;
+							break;
+						}
+					}
+					frames_read++;
+				}
+				port.unlock_image(img);
+			}
+		}));
+	}
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(s_duration_ms));
+	running = false;
+	writer.join();
+	for (size_t i = 0; i < readers.size(); i++)
+		readers[i].join();
+
+	// nothing is written any more, so waiting on the latest frame has to time out
+	bool timed_out = !port.wait_image(port.peek_timestamp(), 50);
+
+	VideoPortStats stats = port.get_stats();
+	printf("latest: frames written: %zu, frames read: %zu, torn frames: %zu, stale frames: %zu\n",
+		(size_t)frames_written, (size_t)frames_read, (size_t)frames_torn, (size_t)frames_stale);
+	printf("latest: stats written: %llu, read: %llu, overwritten: %llu, dropped: %llu\n",
+		(unsigned long long)stats.frames_written, (unsigned long long)stats.frames_read,
+		(unsigned long long)stats.frames_overwritten, (unsigned long long)stats.frames_dropped);
+
+	return frames_torn == 0 && frames_stale == 0 && frames_read > 0 && timed_out
+		&& stats.frames_written == frames_written && stats.frames_read + stats.frames_overwritten <= stats.frames_written
+		&& stats.frames_overwritten > 0 && stats.frames_dropped == 0;
+}
+
+// A fast writer feeds a slow reader through a lossless port, the reader has to see every frame in order.
+static bool test_lossless()
+{
+	VideoPort port(4, VideoPort::Mode::Lossless, -1);
+	size_t size = (size_t)Image::s_default_stride(s_width, PixelFormat::BGR24) * s_height;
+
+	std::thread writer([&]()
+	{
+		Image img(s_width, s_height);
+		for (int i = 0; i < s_lossless_frames; i++)
+		{
+			memset(img.data(), (uint8_t)i, size);
+			port.write_image(&img);
+		}
+	});
+
+	size_t frames_read = 0;
+	size_t frames_out_of_order = 0;
+	uint64_t last_timestamp = (uint64_t)(-1);
+	while (frames_read < (size_t)s_lossless_frames)
+	{
+		if (!port.wait_image(last_timestamp, 1000)) break;
+		uint64_t timestamp;
+		const Image* img = port.lock_image(&timestamp);
+		last_timestamp = timestamp;
+		if (img->data()[0] != (uint8_t)frames_read || img->data()[size - 1] != (uint8_t)frames_read)
+			frames_out_of_order++;
+		frames_read++;
+		if (frames_read % 100 == 0)
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		port.unlock_image(img);
+	}
+	writer.join();
+
+	VideoPortStats stats = port.get_stats();
+	printf("lossless: frames read: %zu, out of order: %zu\n", frames_read, frames_out_of_order);
+	printf("lossless: stats written: %llu, read: %llu, overwritten: %llu, dropped: %llu\n",
+		(unsigned long long)stats.frames_written, (unsigned long long)stats.frames_read,
+		(unsigned long long)stats.frames_overwritten, (unsigned long long)stats.frames_dropped);
+
+	return frames_read == (size_t)s_lossless_frames && frames_out_of_order == 0
+		&& stats.frames_written == (uint64_t)s_lossless_frames && stats.frames_read == (uint64_t)s_lossless_frames
+		&& stats.frames_overwritten == 0 && stats.frames_dropped == 0;
+}
+
+// readers' format requests reach the writer through the port, merged so that no reader gets less than it asked for
+static bool test_format_request()
+{
+	VideoPort port;
+	const VideoSource* source = &port;
+	VideoFormatRequest request;
+	bool before = port.get_format_request(&request);
+
+	int layer, recorder;
+	VideoFormatRequest wanted;
+	wanted.width = 854;
+	wanted.height = 480;
+	wanted.packed = true;
+	source->request_format(wanted, &layer);
+	bool single = port.get_format_request(&request) && request == wanted;
+
+	// a reader that takes the frames as they are keeps them at full size and native format
+	source->request_format(VideoFormatRequest(), &recorder);
+	bool merged = port.get_format_request(&request) && request == VideoFormatRequest();
+
+	source->cancel_format_request(&recorder);
+	bool restored = port.get_format_request(&request) && request == wanted;
+
+	// two sized requests resolve to the larger one
+	VideoFormatRequest larger;
+	larger.width = 1280;
+	larger.height = 720;
+	larger.packed = true;
+	source->request_format(larger, &recorder);
+	bool largest = port.get_format_request(&request) && request == larger;
+
+	source->cancel_format_request(&recorder);
+	source->cancel_format_request(&layer);
+	bool after = port.get_format_request(&request);
+
+	printf("format request: %s before, single %s, merged %s, restored %s, largest %s, %s after\n", before ? "present" : "none",
+		single ? "ok" : "wrong", merged ? "ok" : "wrong", restored ? "ok" : "wrong", largest ? "ok" : "wrong", after ? "present" : "none");
+	return !before && single && merged && restored && largest && !after;
+}
+
+int main()
+{
+	bool passed = test_latest();
+	passed = test_lossless() && passed;
+	passed = test_format_request() && passed;
+	if (!passed)
+	{
+		printf("FAILED\n");
+		return 1;
+	}
+	printf("PASSED\n");
+	return 0;
+}
@@ -0,0 +1,55 @@
+#include <stdio.h>
+#include <WorkerPool.h>
+using namespace LiveKit;
+
+#include <thread>
+#include <atomic>
+#include <vector>
+
+// WorkerPool runs the slices of a pixel conversion in parallel. Every index of a batch must run exactly
+// once before run() returns, also when several threads submit batches to the same pool at the same time
+// and when the pool has no threads of its own, in which case the caller does all the work.
+
+static bool s_check_batches(WorkerPool& pool, int num_callers, int num_batches, int count)
+{
+	std::atomic<int> errors(0);
+	std::vector<std::thread> callers;
+	for (int c = 0; c < num_callers; c++)
+	{
+		callers.push_back(std::thread([&]()
+		{
+			std::vector<std::atomic<int>> hits(count);
+			for (int b = 0; b < num_batches; b++)
+			{
+				for (int i = 0; i < count; i++)
+					hits[i] = 0;
+				pool.run(count, [&](int i) { hits[i]++; });
+				for (int i = 0; i < count; i++)
+					if (hits[i] != 1) errors++;
+			}
+		}));
+	}
+	for (size_t c = 0; c < callers.size(); c++)
+		callers[c].join();
+
+	printf("%d threads, %d callers, %d batches of %d: %d errors\n", pool.num_threads(), num_callers, num_batches, count, errors.load());
+	return errors == 0;
+}
+
+int main()
+{
+	bool passed = true;
+
+	WorkerPool inline_pool(0);
+	passed = s_check_batches(inline_pool, 1, 100, 8) && passed;
+
+	WorkerPool pool(3);
+	passed = s_check_batches(pool, 1, 1000, 4) && passed;
+	passed = s_check_batches(pool, 1, 1000, 17) && passed;
+	passed = s_check_batches(pool, 4, 1000, 6) && passed;
+
+	passed = s_check_batches(WorkerPool::s_get_instance(), 2, 1000, 8) && passed;
+
+	printf(passed ? "PASSED\n" : "FAILED\n");
+	return passed ? 0 : 1;
+}